@@ -0,0 +1,4 @@
+#define BOOST_TEST_MODULE boost_benchmark_plant
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
@@ -0,0 +1,108 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include "../plant_generator/path.h"
+#include <chrono>
+
+using namespace pg;
+
+Path createPath(int controls)
+{
+	Spline spline;
+	spline.setDegree(1);
+	for (int i = 0; i < controls; i++)
+		spline.addControl(Vec3(0.0f, 0.1f*(i%2), 1.0f*i));
+	Path path;
+	path.setSpline(spline);
+	path.generate();
+	return path;
+}
+
+/* The previous implementation summed the segments for each query. */
+Vec3 getSummedIntermediate(const Path &path, float distance)
+{
+	float total = 0.0f;
+	for (size_t i = 0; i < path.getSize() - 1; i++) {
+		float length = magnitude(path.get(i+1) - path.get(i));
+		if (total + length >= distance) {
+			Vec3 direction = path.getDirection(i);
+			return path.get(i) + (distance-total)*direction;
+		}
+		total += length;
+	}
+	return path.get(path.getSize()-1);
+}
+
+BOOST_AUTO_TEST_SUITE(path)
+
+/* The time of each query grows linearly with the number of points if the
+segments are summed and logarithmically with a binary search. */
+BOOST_AUTO_TEST_CASE(benchmark_intermediate)
+{
+	const int queries = 100000;
+	for (int controls = 16; controls <= 4096; controls *= 4) {
+		Path path = createPath(controls);
+		float step = path.getLength() / queries;
+		Vec3 sum1(0.0f, 0.0f, 0.0f);
+		Vec3 sum2(0.0f, 0.0f, 0.0f);
+
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < queries; i++)
+			sum1 += getSummedIntermediate(path, step*i);
+		std::chrono::duration<double> d1 =
+			std::chrono::steady_clock::now() - start;
+
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < queries; i++)
+			sum2 += path.getIntermediate(step*i);
+		std::chrono::duration<double> d2 =
+			std::chrono::steady_clock::now() - start;
+
+		std::cout << controls << " controls: summed ";
+		std::cout << d1.count() * 1e9 / queries << " ns, prefix sums ";
+		std::cout << d2.count() * 1e9 / queries << " ns" << std::endl;
+		BOOST_TEST(magnitude(sum1 - sum2) < 1e-3f * magnitude(sum1));
+	}
+}
+
+/* Compare evaluating each point of a spline with forward differences. */
+BOOST_AUTO_TEST_CASE(benchmark_bezier)
+{
+	const int iterations = 10000;
+	const int points = 16;
+	Spline spline;
+	spline.setDegree(3);
+	for (int i = 0; i < 16; i++)
+		spline.addControl(Vec3(0.1f*(i%3), 0.1f*(i%2), 1.0f*i));
+	int curves = spline.getCurveCount();
+	std::vector<Vec3> p1(curves * points);
+	std::vector<Vec3> p2(curves * points);
+	float delta = 1.0f / points;
+
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++)
+		for (int curve = 0; curve < curves; curve++)
+			for (int j = 0; j < points; j++) {
+				Vec3 &point = p1[curve*points + j];
+				point = spline.getPoint(curve, delta*j);
+			}
+	std::chrono::duration<double> d1 =
+		std::chrono::steady_clock::now() - start;
+
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++)
+		for (int curve = 0; curve < curves; curve++) {
+			Vec3 *span = &p2[curve*points];
+			spline.getPoints(curve, 0.0f, delta, points, span);
+		}
+	std::chrono::duration<double> d2 =
+		std::chrono::steady_clock::now() - start;
+
+	std::cout << "Single points " << d1.count()*1e9/iterations << " ns, ";
+	std::cout << "spans " << d2.count()*1e9/iterations << " ns";
+	std::cout << std::endl;
+	for (size_t i = 0; i < p1.size(); i++)
+		BOOST_TEST(magnitude(p1[i] - p2[i]) < 1e-4f);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
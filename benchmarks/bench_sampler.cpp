@@ -0,0 +1,72 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include "../plant_generator/generator.h"
+#include <cmath>
+
+using namespace pg;
+
+const int referenceRays = 400000;
+
+void getFlux(const Volume::Node *node, std::vector<Vec3> &flux)
+{
+	if (!node->getNode(0)) {
+		flux.push_back(node->getDirection());
+		return;
+	}
+	for (int i = 0; i < 8; i++)
+		getFlux(node->getNode(i), flux);
+}
+
+std::vector<Vec3> getFlux(Generator &generator)
+{
+	std::vector<Vec3> flux;
+	getFlux(generator.getVolume()->getRoot(), flux);
+	return flux;
+}
+
+float getError(
+	const std::vector<Vec3> &flux, const std::vector<Vec3> &reference)
+{
+	float error = 0.0f;
+	for (size_t i = 0; i < flux.size(); i++) {
+		Vec3 d = flux[i] - reference[i];
+		error += dot(d, d);
+	}
+	return std::sqrt(error / flux.size());
+}
+
+BOOST_AUTO_TEST_SUITE(sampler)
+
+/* The root mean square error of the light in the leaf nodes is measured
+against the light of a large number of random rays for the same plant. */
+BOOST_AUTO_TEST_CASE(benchmark_flux_error)
+{
+	Plant plant;
+	plant.setDefault();
+	Generator generator(&plant);
+	generator.cycles = 4;
+	generator.rays = 2000;
+	generator.grow();
+
+	generator.rays = referenceRays;
+	generator.updateFlux();
+	std::vector<Vec3> reference = getFlux(generator);
+
+	const char *names[4] = {"Random", "Stratified", "Halton", "Sobol"};
+	for (int i = 0; i < 4; i++) {
+		generator.sampler = static_cast<Sampler::Type>(i);
+		std::cout << names[i] << ":";
+		for (int rays = 256; rays <= 16384; rays *= 4) {
+			generator.rays = rays;
+			generator.updateFlux();
+			std::vector<Vec3> flux = getFlux(generator);
+			BOOST_TEST(flux.size() == reference.size());
+			float error = getError(flux, reference);
+			std::cout << " " << rays << " rays " << error;
+		}
+		std::cout << std::endl;
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
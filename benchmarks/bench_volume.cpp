@@ -0,0 +1,137 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include "../plant_generator/volume.h"
+#include <chrono>
+#include <random>
+
+using namespace pg;
+
+const int rayCount = 100000;
+const int maxSteps = 1000;
+
+std::vector<Ray> createRays()
+{
+	std::mt19937 mt(0);
+	std::uniform_real_distribution<float> dis1(-0.99f, 0.99f);
+	std::uniform_real_distribution<float> dis2(-1.0f, 1.0f);
+	std::vector<Ray> rays(rayCount);
+	for (Ray &ray : rays) {
+		ray.origin = Vec3(dis1(mt), dis1(mt), 1.45f);
+		ray.direction = normalize(Vec3(dis2(mt), dis2(mt), -1.0f));
+	}
+	return rays;
+}
+
+void createVolume(Volume &volume)
+{
+	std::mt19937 mt(0);
+	std::uniform_real_distribution<float> dis(-0.9f, 0.9f);
+	for (int i = 0; i < 200; i++) {
+		Vec3 a(dis(mt), dis(mt), dis(mt) + 1.0f);
+		Vec3 b(dis(mt), dis(mt), dis(mt) + 1.0f);
+		volume.addLine(a, b, 0.1f, 0.01f);
+	}
+}
+
+void printRate(const char *name, double seconds, size_t nodes)
+{
+	std::cout << name << ": " << rayCount / seconds << " rays/s, ";
+	std::cout << nodes / seconds << " nodes/s" << std::endl;
+}
+
+/* The previous traversal. It intersects the planes of the faces that the
+ray leaves through and relies on small offsets to find the next node. */
+static Volume::Node *getAdjacentNode(
+	Volume::Node *node, Vec3 point, int axis, bool positive)
+{
+	if (!node->getParent())
+		return node;
+	else if (positive)
+		return node->getNextNode(axis, point, 1000);
+	else
+		return node->getPreviousNode(axis, point, 1000);
+}
+
+static Volume::Node *getAdjacentNode(Volume::Node *node, Ray ray)
+{
+	float size = node->getSize();
+	Vec3 d;
+	d.x = ray.direction.x < 0.0f ? -1.0f : 1.0f;
+	d.y = ray.direction.y < 0.0f ? -1.0f : 1.0f;
+	d.z = ray.direction.z < 0.0f ? -1.0f : 1.0f;
+	Plane plane;
+	plane.point = node->getCenter() + size * d;
+
+	Vec3 p;
+	float t;
+
+	plane.normal = Vec3(d.x, 0.0f, 0.0f);
+	t = intersectsPlane(ray, plane);
+	p = t*ray.direction + ray.origin;
+	p.y -= 0.000001f;
+	p.z -= 0.000001f;
+	if (t && d.y*p.y < d.y*plane.point.y && d.z*p.z < d.z*plane.point.z)
+		node = getAdjacentNode(node, p, 1, d.x > 0.0f);
+
+	plane.normal = Vec3(0.0f, d.y, 0.0f);
+	t = intersectsPlane(ray, plane);
+	p = t*ray.direction + ray.origin;
+	p.x -= 0.000001f;
+	p.z -= 0.000001f;
+	if (t && d.x*p.x < d.x*plane.point.x && d.z*p.z < d.z*plane.point.z)
+		node = getAdjacentNode(node, p, 2, d.y > 0.0f);
+
+	plane.normal = Vec3(0.0f, 0.0f, d.z);
+	t = intersectsPlane(ray, plane);
+	p = t*ray.direction + ray.origin;
+	p.y -= 0.000001f;
+	p.x -= 0.000001f;
+	if (t && d.y*p.y < d.y*plane.point.y && d.x*p.x < d.x*plane.point.x)
+		node = getAdjacentNode(node, p, 4, d.z > 0.0f);
+
+	return node;
+}
+
+BOOST_AUTO_TEST_SUITE(volume)
+
+BOOST_AUTO_TEST_CASE(benchmark_traversal)
+{
+	Volume volume(2.0f, 6);
+	createVolume(volume);
+	std::vector<Ray> rays = createRays();
+
+	size_t nodes = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (Ray &ray : rays) {
+		/* The planes can send a ray back to a previous node. */
+		int steps = 0;
+		Volume::Node *node = nullptr;
+		Volume::Node *nextNode = volume.getNode(ray.origin);
+		while (nextNode && node != nextNode && steps++ < maxSteps) {
+			node = nextNode;
+			nextNode = getAdjacentNode(node, ray);
+			nodes++;
+		}
+	}
+	std::chrono::duration<double> d1 =
+		std::chrono::steady_clock::now() - start;
+	printRate("Planes", d1.count(), nodes);
+
+	nodes = 0;
+	start = std::chrono::steady_clock::now();
+	for (Ray &ray : rays) {
+		Volume::Traversal traversal(volume.getNode(ray.origin), ray);
+		Volume::Node *node = traversal.getNode();
+		while (node) {
+			node = traversal.next();
+			nodes++;
+		}
+	}
+	std::chrono::duration<double> d2 =
+		std::chrono::steady_clock::now() - start;
+	printRate("Traversal", d2.count(), nodes);
+	BOOST_TEST(nodes > 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
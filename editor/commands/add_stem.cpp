@@ -35,6 +35,7 @@ void AddStem::create()
 {
 	Plant *plant = this->selection->getPlant();
 	int pathDivisions = 1;
+	float pathTolerance = 0.0f;
 
 	auto instances = this->selection->getStemInstances();
 	if (instances.size() == 1) {
@@ -46,7 +47,9 @@ void AddStem::create()
 			this->parent->getMaterial(Stem::Outer));
 		this->addition->setMaterial(Stem::Inner,
 			this->parent->getMaterial(Stem::Inner));
-		pathDivisions = this->parent->getPath().getDivisions();
+		const pg::Path &parentPath = this->parent->getPath();
+		pathDivisions = parentPath.getDivisions();
+		pathTolerance = parentPath.getTolerance();
 	} else if (instances.empty()) {
 		this->addition = plant->createRoot();
 		this->addition = this->addition;
@@ -62,6 +65,7 @@ void AddStem::create()
 	spline.setDegree(1);
 	path.setSpline(spline);
 	path.setDivisions(pathDivisions);
+	path.subdivide(pathTolerance);
 	this->addition->setPath(path);
 	this->addition->setDistance(0.0f);
 	this->addition->setCustom(true);
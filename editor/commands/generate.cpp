@@ -26,7 +26,8 @@ Generate::Generate(Selection *selection, pg::PatternGenerator *generator) :
 	prevSelection(*selection),
 	removals(selection->getPlant()),
 	remove(&removals),
-	generator(generator)
+	generator(generator),
+	generated(false)
 {
 	createRemovalSelection(this->selection, &this->removals);
 	this->remove.execute();
@@ -52,8 +53,10 @@ void Generate::createRemovalSelection(Selection *selection, Selection *removals)
 
 		Stem *child = stem->getChild();
 		while (child) {
-			if (!child->isCustom())
+			if (!child->isCustom()) {
+				this->generator->forget(child);
 				removals->addStem(child);
+			}
 			child = child->getSibling();
 		}
 	}
@@ -72,8 +75,10 @@ void Generate::removeAdditions()
 		Stem *child = stem->getChild();
 		while (child) {
 			Stem *sibling = child->getSibling();
-			if (!child->isCustom())
+			if (!child->isCustom()) {
+				this->generator->forget(child);
 				plant->deleteStem(child);
+			}
 			child = sibling;
 		}
 	}
@@ -86,6 +91,18 @@ void Generate::execute()
 	auto instances = this->selection->getStemInstances();
 	for (auto instance : instances)
 		this->generator->grow(instance.first);
+	this->generated = true;
+}
+
+void Generate::execute(std::string name)
+{
+	bool updated = this->generated;
+	auto instances = this->selection->getStemInstances();
+	for (auto instance : instances)
+		if (updated)
+			updated = this->generator->grow(instance.first, name);
+	if (!updated)
+		execute();
 }
 
 void Generate::undo()
@@ -104,6 +121,7 @@ void Generate::undo()
 	removeAdditions();
 	this->remove.undo();
 	*this->selection = this->prevSelection;
+	this->generated = false;
 }
 
 void Generate::redo()
@@ -32,6 +32,7 @@ class Generate : public Command {
 	std::vector<pg::ParameterTree> parameterTrees;
 	pg::ParameterTree parameterTree;
 	pg::PatternGenerator *generator;
+	bool generated;
 
 	void createRemovalSelection(Selection *, Selection *);
 	void removeAdditions();
@@ -41,6 +42,9 @@ public:
 	Generate(const Generate &original) = delete;
 	Generate &operator=(const Generate &original) = delete;
 	void execute();
+	/** Only regenerate the stems of a parameter node and its siblings
+	if the stems were generated by this command. */
+	void execute(std::string name);
 	void undo();
 	void redo();
 };
@@ -34,7 +34,7 @@ void Path::set(const pg::Spline &spline, int divisions, Vec3 location)
 	if (!spline.getControls().empty()) {
 		Segment segment;
 		segment.spline = spline;
-		segment.divisions = divisions;
+		segment.divisions.assign(spline.getCurveCount(), divisions);
 		segment.location = location;
 		vector<Segment> segments;
 		segments.push_back(segment);
@@ -46,7 +46,7 @@ void Path::set(vector<Segment> segments)
 {
 	clearPoints();
 	for (auto &segment : segments) {
-		this->divisions.push_back(segment.divisions+1);
+		this->divisions.push_back(segment.divisions);
 		this->degree.push_back(segment.spline.getDegree());
 	}
 	int index = setPoints(segments, 0);
@@ -73,11 +73,12 @@ int Path::setPoints(const vector<Path::Segment> &segments, int index)
 		vector<Vec3> points;
 		this->lineStart.push_back(index);
 
-		float step = 1.0f / (segment.divisions+1);
 		int curves = segment.spline.getCurveCount();
 		for (int curve = 0; curve < curves; curve++) {
+			int divisions = segment.divisions[curve];
+			float step = 1.0f / (divisions+1);
 			float t = 0.0f;
-			for (int i = 0; i <= segment.divisions; i++) {
+			for (int i = 0; i <= divisions; i++) {
 				Vec3 point = segment.spline.getPoint(curve, t);
 				points.push_back(segment.location + point);
 				t += step;
@@ -206,8 +207,11 @@ void Path::colorBezier(const std::set<int> &points, int index)
 
 void Path::colorLine(int point, int index)
 {
-	int offset = this->lineStart[index] + this->divisions[index] * point;
-	for (int i = 1; i <= this->divisions[index]; i++)
+	const vector<int> &divisions = this->divisions[index];
+	int offset = this->lineStart[index];
+	for (int curve = 0; curve < point; curve++)
+		offset += divisions[curve] + 1;
+	for (int i = 1; i <= divisions[point] + 1; i++)
 		this->path.changeColor(offset + i, this->selectionColor);
 }
 
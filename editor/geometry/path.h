@@ -27,7 +27,8 @@
 class Path {
 public:
 	struct Segment {
-		int divisions;
+		/* The number of points between the ends of each curve. */
+		std::vector<int> divisions;
 		pg::Spline spline;
 		pg::Vec3 location;
 	};
@@ -50,7 +51,7 @@ private:
 	pg::Vec3 selectionColor;
 	std::vector<pg::Vec3> points;
 	std::vector<unsigned> indices;
-	std::vector<int> divisions;
+	std::vector<std::vector<int>> divisions;
 	std::vector<int> degree;
 	std::vector<int> controlStart;
 	std::vector<int> pointStart;
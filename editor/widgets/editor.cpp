@@ -782,7 +782,11 @@ void Editor::updateSelection()
 
 			Path::Segment segment;
 			segment.spline = spline;
-			segment.divisions = path.getDivisions();
+			int curves = spline.getCurveCount();
+			for (int curve = 0; curve < curves; curve++) {
+				int divisions = path.getCurveDivisions(curve);
+				segment.divisions.push_back(divisions);
+			}
 			segment.location = location;
 			segments.push_back(segment);
 		}
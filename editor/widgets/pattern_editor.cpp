@@ -358,21 +358,27 @@ void PatternEditor::changeField(std::function<void(StemData *)> function)
 	createCommand();
 	Stem *stem = instances.begin()->first;
 	ParameterTree tree = stem->getParameterTree();
+	std::string name;
 
 	if (this->nodeValue->currentIndex()) {
 		Qt::KeyboardModifiers km = QGuiApplication::keyboardModifiers();
 		if (km.testFlag(Qt::ShiftModifier))
 			tree.updateFields(function);
 		else {
-			QString name = this->nodeValue->currentText();
-			tree.updateField(function, name.toStdString());
+			name = this->nodeValue->currentText().toStdString();
+			tree.updateField(function, name);
 		}
 	}
 
 	for (auto instance : instances)
 		instance.first->setParameterTree(tree);
 
-	this->generate->execute();
+	/* Only the stems of the changed node and its siblings are generated
+	again if a single node changed. */
+	if (name.empty())
+		this->generate->execute();
+	else
+		this->generate->execute(name);
 	this->editor->change();
 }
 
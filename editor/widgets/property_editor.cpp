@@ -70,6 +70,7 @@ void PropertyEditor::createStemLeafFields()
 {
 	this->dl[Radius] = new QLabel("Radius");
 	this->dl[MinRadius] = new QLabel("Min Radius");
+	this->dl[PathTolerance] = new QLabel("Path Tolerance");
 	this->dl[CollarX] = new QLabel("Collar.X");
 	this->dl[CollarY] = new QLabel("Collar.Y");
 	this->dl[ScaleX] = new QLabel("Scale.X");
@@ -157,6 +158,14 @@ void PropertyEditor::createStemLeafFields()
 			s->setPath(path);
 		}, v, this->il[PathDivisions]);});
 
+	connect(this->dv[PathTolerance],
+		QOverload<double>::of(&QDoubleSpinBox::valueChanged),
+		this, [&] (double v) {changeStem([] (Stem *s, double v) {
+			pg::Path path = s->getPath();
+			path.subdivide(v);
+			s->setPath(path);
+		}, v, this->dl[PathTolerance]);});
+
 	connect(this->iv[SectionDivisions],
 		QOverload<int>::of(&QSpinBox::valueChanged),
 		this, [&] (int v) {changeStem([] (Stem *s, int v) {
@@ -265,6 +274,8 @@ void PropertyEditor::createStemInterface(QBoxLayout *layout)
 	form->addRow(this->cl[RadiusCurve], this->cv[RadiusCurve]);
 	this->iv[PathDivisions]->setMinimum(0);
 	form->addRow(this->il[PathDivisions], this->iv[PathDivisions]);
+	this->dv[PathTolerance]->setMinimum(0.0);
+	form->addRow(this->dl[PathTolerance], this->dv[PathTolerance]);
 	this->iv[SectionDivisions]->setMinimum(3);
 	form->addRow(this->il[SectionDivisions], this->iv[SectionDivisions]);
 	this->iv[CollarDivisions]->setMinimum(0);
@@ -321,6 +332,7 @@ void PropertyEditor::enableStemFields(bool enable)
 		indicateSimilarities(this->il[SectionDivisions]);
 		indicateSimilarities(this->il[CollarDivisions]);
 		indicateSimilarities(this->il[PathDivisions]);
+		indicateSimilarities(this->dl[PathTolerance]);
 		indicateSimilarities(this->cl[PathDegree]);
 		indicateSimilarities(this->cl[StemMaterial]);
 		indicateSimilarities(this->cl[CapMaterial]);
@@ -334,6 +346,7 @@ void PropertyEditor::enableStemFields(bool enable)
 	this->iv[SectionDivisions]->setEnabled(enable);
 	this->iv[CollarDivisions]->setEnabled(enable);
 	this->iv[PathDivisions]->setEnabled(enable);
+	this->dv[PathTolerance]->setEnabled(enable);
 	this->cv[PathDegree]->setEnabled(enable);
 	this->cv[StemMaterial]->setEnabled(enable);
 	this->cv[CapMaterial]->setEnabled(enable);
@@ -421,6 +434,8 @@ void PropertyEditor::setStemFields(const map<Stem *, PointSelection> &instances)
 		const pg::Path &path2 = stem->getPath();
 		if (path1.getDivisions() != path2.getDivisions())
 			indicateDifferences(this->il[PathDivisions]);
+		if (path1.getTolerance() != path2.getTolerance())
+			indicateDifferences(this->dl[PathTolerance]);
 
 		const pg::Spline &spline1 = path1.getSpline();
 		const pg::Spline &spline2 = path2.getSpline();
@@ -451,6 +466,7 @@ void PropertyEditor::setStemValues(const Stem *stem)
 	this->iv[SectionDivisions]->setValue(stem->getSectionDivisions());
 	this->iv[CollarDivisions]->setValue(stem->getCollarDivisions());
 	this->iv[PathDivisions]->setValue(stem->getPath().getDivisions());
+	this->dv[PathTolerance]->setValue(stem->getPath().getTolerance());
 	this->dv[Radius]->setValue(stem->getMaxRadius());
 	this->dv[MinRadius]->setValue(stem->getMinRadius());
 	this->cv[RadiusCurve]->setCurrentIndex(stem->getRadiusCurve());
@@ -38,8 +38,8 @@ class PropertyEditor : public QWidget {
 	bool sameAsCurrent;
 
 	enum {SectionDivisions, PathDivisions, CollarDivisions, ISize};
-	enum {Radius, MinRadius, CollarX, CollarY, ScaleX, ScaleY, ScaleZ,
-		DSize};
+	enum {Radius, MinRadius, PathTolerance, CollarX, CollarY, ScaleX,
+		ScaleY, ScaleZ, DSize};
 	enum {RadiusCurve, PathDegree, StemMaterial, CapMaterial, LeafMaterial,
 		LeafMesh, CSize};
 	enum {CustomStem, CustomLeaf, BSize};
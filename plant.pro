@@ -9,7 +9,7 @@ win32::DEFINES += PG_SERIALIZE GL_GLEXT_PROTOTYPES
 unix::QMAKE_LFLAGS += -no-pie
 TARGET = plant
 QT = core gui opengl xml openglextensions
-unix::LIBS += -lboost_serialization
+unix::LIBS += -lboost_serialization -lpthread
 # Change the path name to reflect the Boost version.
 # To install Boost: .\bootstrap.bat; .\b2.exe;
 win32::LIBS += "C:\Program Files\boost\boost_1_75_0\stage\lib\libboost_serialization-vc142-mt-x64-1_75.lib"
@@ -37,6 +37,7 @@ plant_generator/math/curve.cpp \
 plant_generator/math/intersection.cpp \
 plant_generator/math/mat4.cpp \
 plant_generator/math/quat.cpp \
+plant_generator/math/sampler.cpp \
 plant_generator/math/vec2.cpp \
 plant_generator/math/vec3.cpp \
 plant_generator/math/vec4.cpp \
@@ -47,16 +48,22 @@ plant_generator/generator.cpp \
 plant_generator/geometry.cpp \
 plant_generator/joint.cpp \
 plant_generator/leaf.cpp \
+plant_generator/linear_volume.cpp \
 plant_generator/material.cpp \
 plant_generator/mesh.cpp \
+plant_generator/obstacles.cpp \
 plant_generator/parameter_tree.cpp \
 plant_generator/path.cpp \
 plant_generator/plant.cpp \
 plant_generator/pattern_generator.cpp \
 plant_generator/scene.cpp \
+plant_generator/shadow_grid.cpp \
+plant_generator/sky.cpp \
 plant_generator/spline.cpp \
+plant_generator/stand_generator.cpp \
 plant_generator/stem.cpp \
 plant_generator/stem_pool.cpp \
+plant_generator/time_lapse.cpp \
 plant_generator/volume.cpp \
 plant_generator/wind.cpp \
 editor/commands/add_stem.cpp \
@@ -113,6 +120,7 @@ plant_generator/math/curve.h \
 plant_generator/math/intersection.h \
 plant_generator/math/mat4.h \
 plant_generator/math/quat.h \
+plant_generator/math/sampler.h \
 plant_generator/math/vec2.h \
 plant_generator/math/vec3.h \
 plant_generator/math/vec4.h \
@@ -123,16 +131,22 @@ plant_generator/generator.h \
 plant_generator/geometry.h \
 plant_generator/joint.h \
 plant_generator/leaf.h \
+plant_generator/linear_volume.h \
 plant_generator/material.h \
 plant_generator/mesh.h \
+plant_generator/obstacles.h \
 plant_generator/parameter_tree.h \
 plant_generator/path.h \
 plant_generator/plant.h \
 plant_generator/pattern_generator.h \
 plant_generator/scene.h \
+plant_generator/shadow_grid.h \
+plant_generator/sky.h \
 plant_generator/spline.h \
+plant_generator/stand_generator.h \
 plant_generator/stem.h \
 plant_generator/stem_pool.h \
+plant_generator/time_lapse.h \
 plant_generator/volume.h \
 plant_generator/wind.h \
 editor/commands/add_stem.h \
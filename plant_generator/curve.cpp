@@ -17,22 +17,62 @@
 
 using namespace pg;
 
+CurveTable::CurveTable() : last(0.0f)
+{
+
+}
+
+CurveTable::CurveTable(const Spline &spline, int resolution) : last(0.0f)
+{
+	const std::vector<Vec3> &controls = spline.getControls();
+	int degree = spline.getDegree();
+	if (degree < 1 || controls.size() <= static_cast<size_t>(degree))
+		return;
+	this->last = controls.back().y;
+	this->values.resize(resolution + 1);
+	for (int i = 0; i <= resolution; i++) {
+		float t = static_cast<float>(i) / resolution;
+		this->values[i] = spline.getPoint(t).y;
+	}
+}
+
+float CurveTable::getValue(float t) const
+{
+	if (!(t >= 0.0f && t <= 1.0f) || this->values.empty())
+		return this->last;
+	float position = t * (this->values.size() - 1);
+	size_t index = static_cast<size_t>(position);
+	if (index + 1 >= this->values.size())
+		return this->values.back();
+	float s = position - index;
+	return (1.0f-s) * this->values[index] + s * this->values[index+1];
+}
+
+void CurveTable::getValues(const float *t, float *values, size_t size) const
+{
+	for (size_t i = 0; i < size; i++)
+		values[i] = getValue(t[i]);
+}
+
 Curve::Curve()
 {
 
 }
 
-Curve::Curve(int type) : spline(type)
+Curve::Curve(int type) : spline(type), table(spline)
 {
 
 }
 
-Curve::Curve(Spline spline) : spline(spline)
+Curve::Curve(Spline spline) : spline(spline), table(spline)
 {
 
 }
 
-Curve::Curve(Spline spline, std::string name) : spline(spline), name(name)
+Curve::Curve(Spline spline, std::string name) :
+	spline(spline),
+	name(name),
+	table(spline)
 {
 
 }
@@ -50,9 +90,20 @@ std::string Curve::getName() const
 void Curve::setSpline(Spline spline)
 {
 	this->spline = spline;
+	this->table = CurveTable(spline);
 }
 
 Spline Curve::getSpline() const
 {
 	return this->spline;
 }
+
+float Curve::getValue(float t) const
+{
+	return this->table.getValue(t);
+}
+
+void Curve::getValues(const float *t, float *values, size_t size) const
+{
+	this->table.getValues(t, values, size);
+}
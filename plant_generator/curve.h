@@ -18,24 +18,52 @@
 
 #include "spline.h"
 #include <string>
+#include <vector>
 
 #ifdef PG_SERIALIZE
 #include <boost/archive/text_oarchive.hpp>
 #endif
 
 namespace pg {
+	/** The heights of a curve at evenly spaced positions between zero
+	and one. Values between the positions are interpolated linearly,
+	which is faster than finding and evaluating a segment of the
+	spline. */
+	class CurveTable {
+		std::vector<float> values;
+		float last;
+
+	public:
+		CurveTable();
+		CurveTable(const Spline &spline, int resolution = 256);
+		/** Positions outside of [0, 1] return the height of the last
+		control like Spline::getPoint. */
+		float getValue(float t) const;
+		void getValues(
+			const float *t, float *values, size_t size) const;
+	};
+
 	class Curve {
 		Spline spline;
 		std::string name;
+		CurveTable table;
 
 #ifdef PG_SERIALIZE
 		friend class boost::serialization::access;
 		template<class Archive>
-		void serialize(Archive &ar, const unsigned)
+		void save(Archive &ar, const unsigned) const
+		{
+			ar & spline;
+			ar & name;
+		}
+		template<class Archive>
+		void load(Archive &ar, const unsigned)
 		{
 			ar & spline;
 			ar & name;
+			table = CurveTable(spline);
 		}
+		BOOST_SERIALIZATION_SPLIT_MEMBER()
 #endif
 
 	public:
@@ -47,6 +75,10 @@ namespace pg {
 		std::string getName() const;
 		void setSpline(Spline spline);
 		Spline getSpline() const;
+		/** Return the height of the curve from its table. */
+		float getValue(float t) const;
+		void getValues(
+			const float *t, float *values, size_t size) const;
 	};
 }
 
@@ -14,8 +14,24 @@
  */
 
 #include "generator.h"
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <functional>
 #include <limits>
+#include <set>
+#include <thread>
+#include <unordered_map>
+
+#ifdef PG_SERIALIZE
+#include <boost/archive/text_iarchive.hpp>
+#include <boost/archive/text_oarchive.hpp>
+#include <boost/serialization/split_member.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+#include <sstream>
+#include <string>
+#endif
 
 using namespace pg;
 using std::cos;
@@ -23,10 +39,24 @@ using std::sin;
 using std::vector;
 
 const float pi = 3.14159265359f;
+/* Rays are cast in batches that each have their own random number
+generator so that the result does not depend on the number of threads. */
+const int rayBatchSize = 500;
+/* Flux is summed in fixed point with 32 fractional bits. */
+const float fixedPoint = 4294967296.0f;
+/* The number of batches that are cast before an adaptive budget checks if
+the flux has converged. */
+const int roundSize = 4;
+/* Nodes are divided between threads in ranges of at least this size. */
+const size_t minimumRange = 4096;
 
 Generator::Generator(Plant *plant) :
 	plant(plant),
+	cycle(0),
 	width(0.0f),
+	volumeWidth(0.0f),
+	offset(0.0f, 0.0f, 0.0f),
+	patches(),
 	primaryGrowthRate(0.5f),
 	secondaryGrowthRate(0.005f),
 	minRadius(0.001f),
@@ -34,38 +64,138 @@ Generator::Generator(Plant *plant) :
 	synthesisRate(0.001f),
 	synthesisThreshold(0.5f),
 	depth(2),
+	lightModel(RayCasting),
+	shadowDepth(6),
 	rays(10000),
+	rayTolerance(0.0f),
+	rayTime(0.0f),
+	sampler(Sampler::Random),
+	skyDivisions(0),
+	threads(0),
+	obstacles(nullptr),
+	timeLapse(nullptr),
 	cycles(5),
 	nodes(4),
-	seed(0)
+	seed(0),
+	incremental(false)
 {
 
 }
 
 void Generator::grow()
 {
-	this->mt.seed(this->seed);
-	this->width = 1.0f;
-	Stem *root = createRoot();
-	for (int i = 0; i < this->cycles; i++) {
-		if (i > 0) {
-			evaluateEfficiency(&this->volume, root);
+	initialize();
+	resume();
+}
+
+void Generator::resume()
+{
+	Stem *root = this->plant->getRoot();
+	for (; this->cycle < this->cycles; this->cycle++) {
+		if (this->cycle > 0) {
+			prune(&this->volume, root);
 			addStems(root, &this->volume);
 		}
 
 		for (int j = 0; j < this->nodes; j++) {
-			int depth = std::log2(this->width) + this->depth;
-			if (depth <= 0)
-				depth = 1;
-			this->volume.clear(this->width*2.0f, depth);
-			addToVolume(&this->volume, root);
-			generalizeDensity(this->volume.getRoot());
 			setConcentration(root);
-			castRays(&this->volume);
-			generalizeFlux(this->volume.getRoot());
+			updateFlux();
 			addNodes(&this->volume, root, j, nodes);
+			if (this->timeLapse &&
+				this->timeLapse->interval == TimeLapse::Node)
+				this->timeLapse->record(this->plant);
 		}
+		if (this->timeLapse &&
+			this->timeLapse->interval == TimeLapse::Cycle)
+			this->timeLapse->record(this->plant);
 	}
+
+	/* Pools that are emptied by pruning are only released once so that
+	they can be reused by the stems of later cycles. */
+	StemPool *pool = this->plant->getStemPool();
+	this->pruning.poolsBefore = pool->getPoolCount();
+	pool->shrink();
+	this->pruning.poolsAfter = pool->getPoolCount();
+}
+
+int Generator::getCycle() const
+{
+	return this->cycle;
+}
+
+/** The volume is made wide enough to contain the obstacles. Obstacle density
+is kept by incremental updates, so the volume is rebuilt if the obstacles
+are replaced. */
+void Generator::updateFlux()
+{
+	Stem *root = this->plant->getRoot();
+	if (this->obstacles) {
+		updateBoundingBox(this->obstacles->getMin() - this->offset);
+		updateBoundingBox(this->obstacles->getMax() - this->offset);
+	}
+	if (this->patches.obstacles != this->obstacles) {
+		this->patches = Patches();
+		this->patches.obstacles = this->obstacles;
+		this->volumeWidth = 0.0f;
+	}
+
+	bool rebuilt = true;
+	if (this->incremental)
+		rebuilt = updateVolume(&this->volume, root);
+	else {
+		int d = std::log2(this->width) + this->depth;
+		if (d <= 0)
+			d = 1;
+		this->volume.clear(this->width*2.0f, d);
+		addToVolume(&this->volume, root);
+	}
+	if (this->obstacles && rebuilt)
+		mergeObstacles(&this->volume);
+	if (!rebuilt)
+		updateDensity();
+	this->updates.clear();
+	updateLight(&this->volume, rebuilt);
+}
+
+/** The patches are reused until the size of the volume changes. */
+void Generator::mergeObstacles(Volume *volume)
+{
+	float size = volume->getRoot()->getSize();
+	int depth = volume->getDepth();
+	Patches &patches = this->patches;
+	if (patches.size != size || patches.depth != depth) {
+		patches.size = size;
+		patches.depth = depth;
+		this->obstacles->getPatches(volume, patches.patches);
+	}
+	this->obstacles->merge(volume, patches.patches);
+}
+
+/** The density of parent nodes is only generalized if it was not updated
+incrementally. */
+void Generator::updateLight(Volume *volume, bool density)
+{
+	if (this->lightModel == ShadowPropagation)
+		propagateShadows(volume);
+	else
+		castRays(volume);
+	generalize(volume, density);
+}
+
+Stem *Generator::initialize()
+{
+	this->mt.seed(this->seed);
+	this->cycle = 0;
+	this->width = 1.0f;
+	this->volumeWidth = 0.0f;
+	this->segments.clear();
+	this->updates.clear();
+	this->rayCounts.clear();
+	this->patches = Patches();
+	this->pruning = Pruning();
+	if (this->timeLapse)
+		this->timeLapse->clear();
+	return createRoot();
 }
 
 Stem *Generator::createRoot()
@@ -94,12 +224,13 @@ Stem *Generator::createRoot()
 void Generator::addToVolume(Volume *volume, Stem *stem)
 {
 	const Path &path = stem->getPath();
-	Vec3 position = stem->getLocation();
+	Vec3 position = stem->getLocation() + this->offset;
+	std::vector<float> radii(path.getSize());
+	this->plant->getRadii(stem, 0, path.getSize(), radii.data());
 	for (size_t i = 1; i < path.getSize(); i++) {
 		Vec3 a = position + path.get(i-1);
 		Vec3 b = position + path.get(i);
-		float radius = this->plant->getRadius(stem, i);
-		volume->addLine(a, b, 1.0f, radius);
+		volume->addLine(a, b, 1.0f, radii[i]);
 	}
 	Stem *child = stem->getChild();
 	while (child) {
@@ -108,43 +239,408 @@ void Generator::addToVolume(Volume *volume, Stem *stem)
 	}
 }
 
+/** The width of the volume is rounded up to a power of two so that the
+volume only needs to be rebuilt when the plant outgrows it. The volume is
+also rebuilt when a stem grows thick enough to occupy larger nodes, since
+the nodes that were divided for its thinner segments cannot be merged
+again. Returns true if the volume was rebuilt. */
+bool Generator::updateVolume(Volume *volume, Stem *root)
+{
+	if (this->width > this->volumeWidth || !hasResolution(volume, root)) {
+		int exponent = std::ceil(std::log2(this->width));
+		int depth = exponent + this->depth;
+		if (depth <= 0)
+			depth = 1;
+		this->volumeWidth = std::ldexp(1.0f, exponent);
+		volume->clear(this->volumeWidth*2.0f, depth);
+		this->segments.clear();
+		addSegments(volume, root);
+		return true;
+	} else {
+		volume->clearFlux();
+		addSegments(volume, root);
+		return false;
+	}
+}
+
+/** Add the segments of a stem and its descendants that are not part of the
+volume yet. */
+void Generator::addSegments(Volume *volume, Stem *stem)
+{
+	const Path &path = stem->getPath();
+	Vec3 position = stem->getLocation() + this->offset;
+	Segments &segments = this->segments[stem];
+	size_t index = segments.nodes.size();
+	size_t start = segments.size > 0 ? segments.size : 1;
+	size_t size = path.getSize();
+	std::vector<float> radii(size > start ? size - start : 0);
+	this->plant->getRadii(stem, start, size, radii.data());
+	for (size_t i = start; i < size; i++) {
+		Vec3 a = position + path.get(i-1);
+		Vec3 b = position + path.get(i);
+		float radius = radii[i-start];
+		volume->addLine(a, b, 1.0f, radius, segments.nodes);
+		segments.depths.push_back(volume->getLineDepth(radius));
+	}
+	segments.size = path.getSize();
+	this->updates.insert(
+		this->updates.end(),
+		segments.nodes.begin() + index, segments.nodes.end());
+
+	Stem *child = stem->getChild();
+	while (child) {
+		addSegments(volume, child);
+		child = child->getSibling();
+	}
+}
+
+/** Returns true if the segments of a stem and its descendants still have
+the depth that they were added with. */
+bool Generator::hasResolution(const Volume *volume, const Stem *stem)
+{
+	auto it = this->segments.find(stem);
+	if (it != this->segments.end()) {
+		const std::vector<int> &depths = it->second.depths;
+		std::vector<float> radii(depths.size());
+		this->plant->getRadii(stem, 1, depths.size() + 1, radii.data());
+		for (size_t i = 0; i < depths.size(); i++)
+			if (volume->getLineDepth(radii[i]) != depths[i])
+				return false;
+	}
+
+	const Stem *child = stem->getChild();
+	while (child) {
+		if (!hasResolution(volume, child))
+			return false;
+		child = child->getSibling();
+	}
+	return true;
+}
+
+/** Recompute the density of the ancestors of updated nodes. Deeper nodes
+are updated first so that each ancestor is only updated once. */
+void Generator::updateDensity()
+{
+	auto compare = [] (Volume::Node *a, Volume::Node *b) {
+		if (a->getDepth() != b->getDepth())
+			return a->getDepth() > b->getDepth();
+		return a < b;
+	};
+	std::set<Volume::Node *, decltype(compare)> nodes(compare);
+	for (Volume::Node *node : this->updates) {
+		if (node->getNode(0))
+			nodes.insert(node);
+		else if (node->getParent())
+			nodes.insert(node->getParent());
+	}
+
+	while (!nodes.empty()) {
+		Volume::Node *node = *nodes.begin();
+		nodes.erase(nodes.begin());
+		float density = 0.0f;
+		for (int i = 0; i < 8; i++)
+			density += node->getNode(i)->getDensity();
+		node->setDensity(density / 8.0f);
+		if (node->getParent())
+			nodes.insert(node->getParent());
+	}
+}
+
+void Generator::removeSegments(Volume *volume, Stem *stem)
+{
+	auto it = this->segments.find(stem);
+	if (it != this->segments.end()) {
+		const std::vector<Volume::Node *> &nodes = it->second.nodes;
+		volume->removeLine(nodes);
+		this->updates.insert(
+			this->updates.end(), nodes.begin(), nodes.end());
+		this->segments.erase(it);
+	}
+
+	Stem *child = stem->getChild();
+	while (child) {
+		removeSegments(volume, child);
+		child = child->getSibling();
+	}
+}
+
 void Generator::castRays(Volume *volume)
+{
+	int batches = (this->rays + rayBatchSize - 1) / rayBatchSize;
+	Sampler sampler(this->sampler, this->rays, this->mt());
+	this->sky.setDivisions(this->skyDivisions);
+	if (this->rayTolerance > 0.0f || this->rayTime > 0.0f)
+		this->rayCounts.push_back(castRays(volume, sampler));
+	else {
+		castRays(volume, sampler, 0, batches);
+		addFlux(volume);
+		this->rayCounts.push_back(this->rays);
+	}
+}
+
+static void getOccupiedNodes(
+	Volume::Node *node, vector<Volume::Node *> &nodes)
+{
+	if (node->getNode(0))
+		for (int i = 0; i < 8; i++)
+			getOccupiedNodes(node->getNode(i), nodes);
+	else if (node->getDensity() > 0.0f)
+		nodes.push_back(node);
+}
+
+static int64_t toFixed(float value)
+{
+	return std::llround(value * fixedPoint);
+}
+
+static float toFloat(int64_t value)
+{
+	return static_cast<double>(value) / fixedPoint;
+}
+
+/** Rays are cast in rounds until the flux of the nodes that the plant
+occupies has converged. The standard error of the mean flux is estimated
+for each node from the totals of all rounds, and nodes with fewer than two
+samples are given the largest error because light has a magnitude of at
+most one. The rays of each round follow the rays of the previous round in
+the sample sequence. Returns the number of rays that were cast. */
+int Generator::castRays(Volume *volume, const Sampler &sampler)
+{
+	auto start = std::chrono::steady_clock::now();
+	int batches = (this->rays + rayBatchSize - 1) / rayBatchSize;
+	vector<Volume::Node *> nodes;
+	getOccupiedNodes(volume->getRoot(), nodes);
+
+	int batch = 0;
+	while (batch < batches) {
+		int last = std::min(batch + roundSize, batches);
+		castRays(volume, sampler, batch, last);
+		batch = last;
+
+		float error = 0.0f;
+		for (const Volume::Node *node : nodes) {
+			const Flux &f = this->flux[0][node->getIndex()];
+			if (f.count < 2) {
+				error += 1.0f;
+				continue;
+			}
+			float n = f.count;
+			Vec3 sum(toFloat(f.x), toFloat(f.y), toFloat(f.z));
+			float s = toFloat(f.squares) - dot(sum, sum) / n;
+			error += std::max(s, 0.0f) / (n - 1.0f) / n;
+		}
+		if (!nodes.empty())
+			error = std::sqrt(error / nodes.size());
+		if (error <= this->rayTolerance)
+			break;
+
+		std::chrono::duration<float> elapsed =
+			std::chrono::steady_clock::now() - start;
+		if (this->rayTime > 0.0f && elapsed.count() >= this->rayTime)
+			break;
+	}
+	addFlux(volume);
+	return std::min(batch * rayBatchSize, this->rays);
+}
+
+/** Returns the number of threads for an amount of work. */
+int Generator::getThreadCount(int work) const
+{
+	int threads = this->threads;
+	if (threads <= 0)
+		threads = std::thread::hardware_concurrency();
+	if (threads > work)
+		threads = work;
+	return std::max(threads, 1);
+}
+
+/* Call a function on ranges of nodes that are divided between threads. */
+static void divideNodes(
+	size_t size, int threads,
+	const std::function<void(size_t, size_t)> &function)
+{
+	size_t range = (size + threads - 1) / threads;
+	std::vector<std::thread> workers;
+	for (int i = 1; i < threads; i++) {
+		size_t first = std::min(i * range, size);
+		size_t last = std::min(first + range, size);
+		workers.emplace_back(function, first, last);
+	}
+	function(0, std::min(range, size));
+	for (std::thread &worker : workers)
+		worker.join();
+}
+
+/** Cast the rays of a range of batches. Every thread adds its rays to its
+own totals, which are indexed by node. The totals of the other threads are
+then added to the first totals, which keep the flux of every range until
+it is added to the volume. */
+void Generator::castRays(
+	Volume *volume, const Sampler &sampler, int first, int last)
+{
+	int batches = last - first;
+	int threads = getThreadCount(batches);
+	size_t size = volume->getNodeCount();
+	if (this->flux.size() < static_cast<size_t>(threads))
+		this->flux.resize(threads);
+	for (std::vector<Flux> &totals : this->flux)
+		totals.resize(size, Flux());
+
+	std::atomic<int> next(0);
+	auto cast = [&] (std::vector<Flux> *totals) {
+		int batch;
+		while ((batch = next++) < batches)
+			castRays(volume, sampler, first + batch, *totals);
+	};
+	std::vector<std::thread> workers;
+	for (int i = 1; i < threads; i++)
+		workers.emplace_back(cast, &this->flux[i]);
+	cast(&this->flux[0]);
+	for (std::thread &worker : workers)
+		worker.join();
+
+	if (threads > 1) {
+		int ranges = getThreadCount(size / minimumRange);
+		divideNodes(size, ranges, [this, threads] (size_t a, size_t b) {
+			mergeFlux(threads, a, b);
+		});
+	}
+}
+
+/** Add the totals of threads to the first totals and clear them. Only the
+totals of the threads that cast rays can be nonzero. */
+void Generator::mergeFlux(int threads, size_t first, size_t last)
+{
+	for (int i = 1; i < threads; i++) {
+		for (size_t j = first; j < last; j++) {
+			Flux &a = this->flux[0][j];
+			Flux &b = this->flux[i][j];
+			a.x += b.x;
+			a.y += b.y;
+			a.z += b.z;
+			a.squares += b.squares;
+			a.count += b.count;
+			b = Flux();
+		}
+	}
+}
+
+void Generator::castRays(
+	Volume *volume, const Sampler &sampler, int batch,
+	std::vector<Flux> &flux)
 {
 	float w = this->width - 0.0001f;
-	std::uniform_real_distribution<float> dis1(-w, w);
-	std::uniform_real_distribution<float> dis2(-1.0f, 1.0f);
-	for (int i = 1; i <= this->rays; i++) {
-		float x = dis1(this->mt);
-		float y = dis1(this->mt);
-		float z = this->width*1.5f;
-		Vec3 origin(x, y, z);
+	int start = batch * rayBatchSize;
+	int end = std::min(start + rayBatchSize, this->rays);
+	for (int i = start; i < end; i++) {
+		float sample[PG_SAMPLER_DIMENSIONS];
+		sampler.getSample(i, sample);
 		Ray ray;
-		ray.origin = Vec3(x, y, z);
-		x = dis2(this->mt);
-		y = dis2(this->mt);
-		z = -1.0f;
-		ray.direction = normalize(Vec3(x, y, z));
-		updateRadiantEnergy(volume, ray);
+		if (this->skyDivisions > 0) {
+			ray = getSkyRay(volume, sample);
+		} else {
+			ray.origin.x = (2.0f*sample[0] - 1.0f) * w;
+			ray.origin.y = (2.0f*sample[1] - 1.0f) * w;
+			ray.origin.z = this->width*1.5f;
+			ray.direction.x = 2.0f*sample[2] - 1.0f;
+			ray.direction.y = 2.0f*sample[3] - 1.0f;
+			ray.direction.z = -1.0f;
+			ray.direction = normalize(ray.direction);
+		}
+		updateRadiantEnergy(volume, ray, flux);
 	}
 }
 
-void Generator::updateRadiantEnergy(Volume *volume, Ray ray)
+/** Each leaf node receives the light at its center as if a single ray
+passed through it. */
+void Generator::propagateShadows(Volume *volume)
+{
+	this->shadows.setVolume(volume, this->shadowDepth);
+	this->shadows.propagate(this->threads);
+	volume->reduce([this] (Volume::Node *node) {
+		if (!node->getNode(0)) {
+			Vec3 flux = this->shadows.getFlux(node->getCenter());
+			node->setDirection(flux);
+			node->setQuantity(1);
+		}
+	}, this->threads);
+}
+
+/** The direction is sampled from the sky and the ray enters the volume
+through a face that is visible from the direction. Faces are chosen in
+proportion to their visible area so that rays are spread evenly over the
+cross section of the volume. */
+Ray Generator::getSkyRay(const Volume *volume, const float *sample) const
+{
+	float u = sample[2];
+	int bin = this->sky.getBin(u);
+	Ray ray;
+	ray.direction = this->sky.getDirection(bin, u, sample[3]);
+
+	const float d[3] = {ray.direction.x, ray.direction.y, ray.direction.z};
+	const float area[3] = {std::abs(d[0]), std::abs(d[1]), std::abs(d[2])};
+	float a = sample[0] * (area[0] + area[1] + area[2]);
+	int axis = 0;
+	while (axis < 2 && a >= area[axis])
+		a -= area[axis++];
+	float s = area[axis] > 0.0f ? std::min(a / area[axis], 1.0f) : 0.0f;
+
+	const Volume::Node *root = volume->getRoot();
+	Vec3 center = root->getCenter();
+	float size = root->getSize() - 0.0001f;
+	const float c[3] = {center.x, center.y, center.z};
+	float p[3];
+	p[axis] = d[axis] > 0.0f ? c[axis] - size : c[axis] + size;
+	p[(axis+1)%3] = c[(axis+1)%3] + (2.0f*s - 1.0f) * size;
+	p[(axis+2)%3] = c[(axis+2)%3] + (2.0f*sample[1] - 1.0f) * size;
+	ray.origin = Vec3(p[0], p[1], p[2]);
+	return ray;
+}
+
+void Generator::updateRadiantEnergy(
+	Volume *volume, Ray ray, std::vector<Flux> &flux)
 {
 	float magnitude = 1.0f;
-	Volume::Node *node = nullptr;
-	Volume::Node *nextNode = volume->getNode(ray.origin);
-	while (nextNode && node != nextNode) {
-		node = nextNode;
-		node->setQuantity(node->getQuantity() + 1);
+	Volume::Traversal traversal(volume->getNode(ray.origin), ray);
+	Volume::Node *node = traversal.getNode();
+	while (node) {
 		Vec3 direction = magnitude * ray.direction;
-		node->setDirection(node->getDirection() + direction);
+		Flux &f = flux[node->getIndex()];
+		f.x += toFixed(direction.x);
+		f.y += toFixed(direction.y);
+		f.z += toFixed(direction.z);
+		f.squares += toFixed(dot(direction, direction));
+		f.count++;
 		magnitude -= node->getDensity();
 		if (magnitude < 0.0f)
 			magnitude = 0.0f;
-		nextNode = node->getAdjacentNode(ray);
+		node = traversal.next();
 	}
 }
 
+/** Add the first totals of each node to its flux and clear them. Nodes
+are divided between threads. */
+void Generator::addFlux(Volume *volume)
+{
+	if (this->flux.empty())
+		return;
+	std::vector<Flux> &flux = this->flux[0];
+	auto add = [volume, &flux] (size_t first, size_t last) {
+		for (size_t i = first; i < last; i++) {
+			Flux &f = flux[i];
+			if (f.count == 0)
+				continue;
+			Volume::Node *node = volume->getNode(i);
+			Vec3 d(toFloat(f.x), toFloat(f.y), toFloat(f.z));
+			node->setDirection(node->getDirection() + d);
+			node->setQuantity(node->getQuantity() + f.count);
+			f = Flux();
+		}
+	};
+	int threads = getThreadCount(flux.size() / minimumRange);
+	divideNodes(flux.size(), threads, add);
+}
+
 float Generator::setConcentration(Stem *stem)
 {
 	Stem *child = stem->getChild();
@@ -157,50 +653,71 @@ float Generator::setConcentration(Stem *stem)
 	return total;
 }
 
-void Generator::generalizeDensity(Volume::Node *node)
-{
-	float density = 0.0f;
-	for (int i = 0; i < 8; i++) {
-		Volume::Node *child = node->getNode(i);
-		if (child->getNode(0))
-			generalizeDensity(child);
-		density += child->getDensity();
-	}
-	node->setDensity(density / 8.0f);
-}
-
-void Generator::generalizeFlux(Volume::Node *node)
+/* The children of the node are already generalized. */
+static void generalizeNode(Volume::Node *node, bool density)
 {
+	float sum = 0.0f;
 	Vec3 direction(0.0f, 0.0f, 0.0f);
 	float count = 0.0f;
 	for (int i = 0; i < 8; i++) {
-		Volume::Node *n = node->getNode(i);
-		if (n->getNode(0))
-			generalizeFlux(n);
-		else if (n->getQuantity() > 0) {
-			Vec3 f = n->getDirection() / n->getQuantity();
-			float m = magnitude(f);
-			if (m > 1.0f)
-				n->setDirection(f/m);
-			else
-				n->setDirection(f);
-		}
+		const Volume::Node *n = node->getNode(i);
+		sum += n->getDensity();
 		if (!isZero(n->getDirection())) {
 			count += 1.0f;
 			direction += n->getDirection();
 		}
 	}
+	if (density)
+		node->setDensity(sum / 8.0f);
 	if (count > 0.0f)
 		node->setDirection(direction / count);
 }
 
-float Generator::evaluateEfficiency(Volume *volume, Stem *stem)
+/** Rays only pass through leaf nodes, so the density of parent nodes is
+computed together with the flux after rays are cast if the volume was
+rebuilt. */
+void Generator::generalize(Volume *volume, bool density)
+{
+	volume->reduce([density] (Volume::Node *node) {
+		if (node->getNode(0))
+			generalizeNode(node, density);
+		else if (node->getQuantity() > 0) {
+			Vec3 f = node->getDirection() / node->getQuantity();
+			float m = magnitude(f);
+			if (m > 1.0f)
+				node->setDirection(f/m);
+			else
+				node->setDirection(f);
+		}
+	}, this->threads);
+}
+
+/** Inefficient stems are collected first and then deleted together. */
+void Generator::prune(Volume *volume, Stem *root)
+{
+	std::vector<Stem *> stems;
+	evaluateEfficiency(volume, root, stems);
+
+	StemPool *pool = this->plant->getStemPool();
+	this->pruning.stemsBefore = pool->getStemCount();
+	if (this->incremental)
+		for (Stem *stem : stems)
+			removeSegments(volume, stem);
+	this->plant->deleteStems(stems);
+	this->pruning.stemsAfter = pool->getStemCount();
+}
+
+/** Stems are added after their descendants. A pruned stem replaces any of
+its descendants that were added before it. */
+float Generator::evaluateEfficiency(
+	Volume *volume, Stem *stem, std::vector<Stem *> &stems)
 {
 	float total = 0.0f;
+	size_t first = stems.size();
 
 	for (size_t i = 0; i < stem->getLeafCount(); i++) {
 		const Leaf *leaf = stem->getLeaf(i);
-		Vec3 location = stem->getLocation();
+		Vec3 location = stem->getLocation() + this->offset;
 		float position = leaf->getPosition();
 		location += stem->getPath().getIntermediate(position);
 		Volume::Node *node = volume->getNode(location);
@@ -209,16 +726,17 @@ float Generator::evaluateEfficiency(Volume *volume, Stem *stem)
 
 	Stem *child = stem->getChild();
 	while (child) {
-		Stem *sibling = child->getSibling();
-		total += evaluateEfficiency(volume, child);
-		child = sibling;
+		total += evaluateEfficiency(volume, child, stems);
+		child = child->getSibling();
 	}
 
 	float r = stem->getMaxRadius();
 	float l = stem->getPath().getLength();
 	float p = total/(total + l*r*r);
-	if (stem->getParent() && p < this->synthesisThreshold)
-		this->plant->deleteStem(stem);
+	if (stem->getParent() && p < this->synthesisThreshold) {
+		stems.resize(first);
+		stems.push_back(stem);
+	}
 
 	return total;
 }
@@ -267,29 +785,24 @@ void Generator::addNode(Volume *volume, Stem *stem, int i, int n)
 	} else
 		updateRadius(stem);
 
-	Path path = stem->getPath();
-	Spline spline = path.getSpline();
-	std::vector<Vec3> controls = spline.getControls();
-
+	/* The last point of the path is the last control of the spline. */
+	const Path &path = stem->getPath();
 	Ray ray;
-	ray.origin = controls.back();
+	ray.origin = path.get(path.getSize()-1);
 	ray.direction = path.getDirection(path.getSize()-1);
-	Vec3 direction = getDirection(stem, ray.origin, ray.direction, volume);
+	Vec3 origin = ray.origin + this->offset;
+	Vec3 direction = getDirection(stem, origin, ray.direction, volume);
 	Vec3 point = ray.origin + rate * this->primaryGrowthRate * direction;
-
-	controls.push_back(point);
-	spline.setControls(controls);
-	path.setSpline(spline);
-	stem->setPath(path);
+	stem->extendPath(point);
 
 	updateBoundingBox(point + stem->getLocation());
 	addLeaves(stem, stem->getState()->node++);
 }
 
-Vec3 getInitialDirection(Leaf leaf, Stem *stem, Volume *volume)
+Vec3 getInitialDirection(Leaf leaf, Stem *stem, Vec3 offset, Volume *volume)
 {
 	Vec3 d = rotate(leaf.getRotation(), Vec3(0.0f, 1.0f, 0.0f));
-	return getDirection(stem, Vec3(0.0f, 0.0f, 0.0f), d, volume);
+	return getDirection(stem, offset, d, volume);
 }
 
 void Generator::addStems(Stem *stem, Volume *volume)
@@ -309,7 +822,8 @@ void Generator::addStem(Stem *stem, Volume *volume)
 		Leaf leaf = *stem->getLeaf(i);
 		stem->removeLeaf(i--);
 
-		Vec3 direction = getInitialDirection(leaf, stem, volume);
+		Vec3 direction = getInitialDirection(
+			leaf, stem, this->offset, volume);
 		Vec3 point = (this->primaryGrowthRate/2.0f) * direction;
 
 		Stem *child = this->plant->addStem(stem);
@@ -361,6 +875,7 @@ Leaf Generator::createLeaf()
 /** A bounding box is created to determine how rays should be generated. */
 void Generator::updateBoundingBox(Vec3 point)
 {
+	point += this->offset;
 	point.x = std::abs(point.x) * 2.0f + 0.1f;
 	point.y = std::abs(point.y) * 2.0f + 0.1f;
 	point.z = std::abs(point.z) * 2.0f + 0.1f;
@@ -375,10 +890,140 @@ void Generator::updateBoundingBox(Vec3 point)
 void Generator::clearVolume()
 {
 	this->width = 1.0f;
+	this->volumeWidth = 0.0f;
+	this->segments.clear();
 	this->volume.clear(this->width, this->depth);
 }
 
+const std::vector<int> &Generator::getRayCounts() const
+{
+	return this->rayCounts;
+}
+
+Generator::Pruning Generator::getPruning() const
+{
+	return this->pruning;
+}
+
 const Volume *Generator::getVolume()
 {
 	return &this->volume;
 }
+
+#ifdef PG_SERIALIZE
+/* Stems and nodes are saved as indices into a depth-first order, which is
+the same for the saved and loaded trees. */
+template<class Stem>
+static void getStems(Stem *stem, vector<Stem *> &stems)
+{
+	while (stem) {
+		stems.push_back(stem);
+		getStems(stem->getChild(), stems);
+		stem = stem->getSibling();
+	}
+}
+
+template<class Node>
+static void getNodes(Node *node, vector<Node *> &nodes)
+{
+	nodes.push_back(node);
+	for (int i = 0; node->getNode(0) && i < 8; i++)
+		getNodes(node->getNode(i), nodes);
+}
+
+template<class Archive>
+void Generator::serialize(Archive &ar, const unsigned version)
+{
+	boost::serialization::split_member(ar, *this, version);
+}
+
+template<class Archive>
+void Generator::save(Archive &ar, const unsigned) const
+{
+	std::ostringstream stream;
+	stream << this->mt;
+	std::string engine = stream.str();
+	ar & engine;
+	ar & *this->plant;
+	ar & this->cycle;
+	ar & this->width;
+	ar & this->volume;
+	ar & this->volumeWidth;
+
+	vector<const Volume::Node *> nodes;
+	getNodes(this->volume.getRoot(), nodes);
+	std::unordered_map<const Volume::Node *, int> indices;
+	for (size_t i = 0; i < nodes.size(); i++)
+		indices[nodes[i]] = i;
+	auto getIndices = [&] (const vector<Volume::Node *> &nodes) {
+		vector<int> result;
+		result.reserve(nodes.size());
+		for (const Volume::Node *node : nodes)
+			result.push_back(indices.at(node));
+		return result;
+	};
+
+	const Stem *root = this->plant->getRoot();
+	vector<const Stem *> stems;
+	getStems(root, stems);
+	for (const Stem *stem : stems) {
+		auto it = this->segments.find(stem);
+		bool added = it != this->segments.end();
+		ar & added;
+		if (added) {
+			vector<int> segments = getIndices(it->second.nodes);
+			ar & it->second.size;
+			ar & it->second.depths;
+			ar & segments;
+		}
+	}
+	vector<int> updates = getIndices(this->updates);
+	ar & updates;
+}
+
+/** Obstacles that are set before a generator is loaded are assumed to be
+the obstacles that the plant was grown with. */
+template<class Archive>
+void Generator::load(Archive &ar, const unsigned)
+{
+	std::string engine;
+	ar & engine;
+	std::istringstream stream(engine);
+	stream >> this->mt;
+	this->plant->removeRoot();
+	ar & *this->plant;
+	ar & this->cycle;
+	ar & this->width;
+	ar & this->volume;
+	ar & this->volumeWidth;
+
+	vector<Volume::Node *> nodes;
+	getNodes(this->volume.getRoot(), nodes);
+	vector<Stem *> stems;
+	getStems(this->plant->getRoot(), stems);
+	this->segments.clear();
+	for (Stem *stem : stems) {
+		bool added;
+		ar & added;
+		if (added) {
+			Segments &segments = this->segments[stem];
+			vector<int> indices;
+			ar & segments.size;
+			ar & segments.depths;
+			ar & indices;
+			for (int index : indices)
+				segments.nodes.push_back(nodes[index]);
+		}
+	}
+	vector<int> updates;
+	ar & updates;
+	this->updates.clear();
+	for (int index : updates)
+		this->updates.push_back(nodes[index]);
+	this->patches = Patches();
+	this->patches.obstacles = this->obstacles;
+}
+
+template void Generator::serialize(boost::archive::text_oarchive &, unsigned);
+template void Generator::serialize(boost::archive::text_iarchive &, unsigned);
+#endif
@@ -18,27 +18,100 @@
 
 #include "plant.h"
 #include "mesh.h"
+#include "obstacles.h"
+#include "shadow_grid.h"
+#include "sky.h"
+#include "time_lapse.h"
 #include "volume.h"
 #include "math/intersection.h"
+#include "math/sampler.h"
+#include <cstdint>
 #include <vector>
 #include <map>
 #include <random>
 
 namespace pg {
+	class StandGenerator;
+
 	class Generator {
+		/* Nodes occupied by the segments of a stem that were added to
+		the volume in incremental mode. */
+		struct Segments {
+			size_t size;
+			/* The depth of the nodes of each segment. */
+			std::vector<int> depths;
+			std::vector<Volume::Node *> nodes;
+		};
+
+		/* Obstacle cells grouped by the nodes of a volume of a
+		size. Volumes only grow when the plant does, so the patches
+		rarely need to be recomputed. */
+		struct Patches {
+			const Obstacles *obstacles;
+			float size;
+			int depth;
+			std::vector<Obstacles::Patch> patches;
+		};
+
+		/* The light that passed through a node in fixed point. Sums
+		of integers do not depend on the order that rays are added in,
+		so threads can add rays to their own totals. The squares are
+		used to estimate the error of the flux. */
+		struct Flux {
+			int64_t x;
+			int64_t y;
+			int64_t z;
+			int64_t squares;
+			int count;
+		};
+
 		Plant *plant;
+		int cycle;
 		float width;
+		float volumeWidth;
+		/* The location of the plant in the volume. */
+		Vec3 offset;
 		Volume volume;
+		Sky sky;
+		ShadowGrid shadows;
 		std::mt19937 mt;
+		std::map<const Stem *, Segments> segments;
+		/* Nodes of which the density changed since the volume was last
+		updated in incremental mode. */
+		std::vector<Volume::Node *> updates;
+		std::vector<int> rayCounts;
+		Patches patches;
+		/* The totals of each thread are kept between updates so that
+		they are only allocated when the volume grows. Totals are zero
+		when rays are not being cast. */
+		std::vector<std::vector<Flux>> flux;
 
+		Stem *initialize();
 		Stem *createRoot();
 		void addToVolume(Volume *, Stem *);
+		bool updateVolume(Volume *, Stem *);
+		void addSegments(Volume *, Stem *);
+		bool hasResolution(const Volume *, const Stem *);
+		void removeSegments(Volume *, Stem *);
+		void updateDensity();
+		void mergeObstacles(Volume *);
+		void updateLight(Volume *, bool density = true);
 		void castRays(Volume *);
-		void updateRadiantEnergy(Volume *, Ray);
+		int castRays(Volume *, const Sampler &);
+		int getThreadCount(int) const;
+		void castRays(Volume *, const Sampler &, int, int);
+		void mergeFlux(int, size_t, size_t);
+		void castRays(
+			Volume *, const Sampler &, int, std::vector<Flux> &);
+		Ray getSkyRay(const Volume *, const float *) const;
+		void updateRadiantEnergy(Volume *, Ray, std::vector<Flux> &);
+		void addFlux(Volume *);
+		void propagateShadows(Volume *);
 		float setConcentration(Stem *);
-		void generalizeDensity(Volume::Node *);
-		void generalizeFlux(Volume::Node *);
-		float evaluateEfficiency(Volume *, Stem *);
+		void generalize(Volume *, bool);
+		void prune(Volume *, Stem *);
+		float evaluateEfficiency(
+			Volume *, Stem *, std::vector<Stem *> &);
 		void addNodes(Volume *, Stem *, int, int);
 		void addNode(Volume *, Stem *, int, int);
 		void updateRadius(Stem *);
@@ -48,7 +121,21 @@ namespace pg {
 		Leaf createLeaf();
 		void updateBoundingBox(Vec3);
 
+		friend class StandGenerator;
+
 	public:
+		enum LightModel {RayCasting, ShadowPropagation};
+
+		/** The number of allocated stems before and after stems were
+		last pruned, and the number of stem pools before and after
+		empty pools were released at the end of growth. */
+		struct Pruning {
+			size_t poolsBefore = 0;
+			size_t poolsAfter = 0;
+			size_t stemsBefore = 0;
+			size_t stemsAfter = 0;
+		};
+
 		float primaryGrowthRate;
 		float secondaryGrowthRate;
 		float minRadius;
@@ -56,15 +143,81 @@ namespace pg {
 		float synthesisRate;
 		float synthesisThreshold;
 		int depth;
+		/** Light is either found by casting rays or by propagating
+		shadows downward through a grid. */
+		LightModel lightModel;
+		/** The grid has 2^shadowDepth cells along each axis. */
+		int shadowDepth;
+		/** The number of rays cast for each node, or the maximum
+		number of rays if the budget is adaptive. */
 		int rays;
+		/** Rays are cast in rounds until the standard error of the
+		light in occupied nodes is below the tolerance. The budget is
+		fixed if the value is zero. */
+		float rayTolerance;
+		/** Stop casting rays after a number of seconds even if the
+		tolerance is not met. The result then depends on the speed of
+		the machine. There is no limit if the value is zero. */
+		float rayTime;
+		/** The sequence that the origins and directions of rays are
+		drawn from. */
+		Sampler::Type sampler;
+		/** The number of rings of the sky dome that rays are sampled
+		from. Rays are cast downward from a fixed height if the value is
+		zero. */
+		int skyDivisions;
+		/** The number of threads used to cast rays. All available
+		hardware threads are used if the value is zero. */
+		int threads;
+		/** Static geometry that blocks light. The cells are merged
+		into the volume after the plant is added to it. Cells are
+		cached per generator, so obstacles should not be changed while
+		a plant grows. */
+		const Obstacles *obstacles;
+		/** Changes to the plant are recorded after every cycle or
+		node if a time-lapse is set. */
+		TimeLapse *timeLapse;
 		int cycles;
 		int nodes;
 		int seed;
+		/** Only add new segments to the volume and only remove pruned
+		segments instead of rebuilding it for every node. */
+		bool incremental;
 
 		Generator(Plant *plant);
 		void grow();
+		/** Continue growing a plant from the last completed cycle, such
+		as after a generator is loaded. */
+		void resume();
+		/** Return the number of completed cycles. */
+		int getCycle() const;
+		/** Cast rays through a volume of the current plant. This can be
+		used to compare the light of different samplers for the same
+		plant after it is grown. */
+		void updateFlux();
 		void clearVolume();
+		Pruning getPruning() const;
+		/** Return the number of rays that were cast for each node
+		since the plant was last grown. */
+		const std::vector<int> &getRayCounts() const;
 		const Volume *getVolume();
+
+	private:
+		Pruning pruning;
+
+#ifdef PG_SERIALIZE
+		/* The plant, the volume and the segments of incremental mode
+		are saved with the random engine so that a resumed plant grows
+		as if it was never interrupted. The definitions are
+		instantiated for text archives in generator.cpp. */
+		friend class boost::serialization::access;
+		template<class Archive>
+		void serialize(Archive &, const unsigned);
+		template<class Archive>
+		void save(Archive &, const unsigned) const;
+		template<class Archive>
+		void load(Archive &, const unsigned);
+#endif
 	};
 }
 
@@ -0,0 +1,372 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "linear_volume.h"
+#include <algorithm>
+#include <limits>
+
+using pg::LinearVolume;
+using pg::Ray;
+using pg::Vec3;
+
+typedef LinearVolume::Node Node;
+
+/* Bits of the x coordinate in a Morton code. The bits of the y and z
+coordinates are shifted by one and two. */
+const uint64_t xBits = 0x1249249249249249ull;
+const size_t none = std::numeric_limits<size_t>::max();
+
+static int getCodeDepth(uint64_t code)
+{
+	int depth = 0;
+	while (code > 1) {
+		code >>= 3;
+		depth++;
+	}
+	return depth;
+}
+
+/* Extract the coordinate of the first axis from interleaved bits. */
+static uint32_t compact(uint64_t code)
+{
+	uint32_t value = 0;
+	for (int i = 0; i <= PG_LINEAR_VOLUME_MAX_DEPTH; i++)
+		value |= static_cast<uint32_t>((code >> 3*i) & 1) << i;
+	return value;
+}
+
+static uint32_t toCoordinate(float value, float min, float cell, int depth)
+{
+	float coordinate = std::floor((value - min) / cell);
+	float max = static_cast<float>((1u << depth) - 1);
+	return static_cast<uint32_t>(std::min(std::max(coordinate, 0.0f), max));
+}
+
+LinearVolume::LinearVolume(float size, int depth)
+{
+	clear(size, depth);
+}
+
+/** The memory of the previous volume is reused. */
+void LinearVolume::clear(float size, int depth)
+{
+	this->size = size;
+	this->depth = std::min(depth, PG_LINEAR_VOLUME_MAX_DEPTH);
+	this->nodes.clear();
+	this->nodes.push_back(Node(1));
+}
+
+Node *LinearVolume::addNode(Vec3 point, int depth)
+{
+	return &this->nodes[getIndex(point, depth, true)];
+}
+
+void LinearVolume::addLine(Vec3 a, Vec3 b, float weight, float radius)
+{
+	float length = magnitude(b-a);
+	int depth = std::abs(std::log2(radius/this->size))-1;
+	size_t index = getIndex(a, depth, true);
+	size_t lastIndex = getIndex(b, depth, true);
+	a = getCenter(&this->nodes[index]);
+	b = getCenter(&this->nodes[lastIndex]);
+	Ray ray(a, normalize(b-a));
+	this->nodes[index].density = weight;
+
+	while (index != lastIndex) {
+		Vec3 center = getCenter(&this->nodes[index]);
+		if (magnitude(a-center) > length)
+			break;
+		size_t nextIndex = getAdjacentIndex(index, ray, depth, true);
+		if (nextIndex == index)
+			break;
+		index = nextIndex;
+		this->nodes[index].density = weight;
+	}
+}
+
+Node *LinearVolume::getNode(Vec3 point)
+{
+	return &this->nodes[getIndex(point, this->depth, false)];
+}
+
+Node *LinearVolume::getNode(uint64_t code)
+{
+	size_t index = getIndex(code);
+	return index == none ? nullptr : &this->nodes[index];
+}
+
+Node *LinearVolume::getParent(const Node *node)
+{
+	return node->code > 1 ? getNode(node->code >> 3) : nullptr;
+}
+
+Node *LinearVolume::getChild(const Node *node, int index)
+{
+	if (node->children)
+		return &this->nodes[node->children + index];
+	else
+		return nullptr;
+}
+
+/** Return the neighbouring node that the ray enters when it leaves a node.
+The node itself is returned if the ray leaves the volume. */
+Node *LinearVolume::getAdjacentNode(const Node *node, Ray ray, int depth)
+{
+	size_t index = node - &this->nodes[0];
+	return &this->nodes[getAdjacentIndex(index, ray, depth, false)];
+}
+
+Node *LinearVolume::getRoot()
+{
+	return &this->nodes[0];
+}
+
+Vec3 LinearVolume::getCenter(const Node *node) const
+{
+	int depth = getCodeDepth(node->code);
+	uint64_t code = node->code & ((1ull << 3*depth) - 1);
+	float cell = this->size / (1u << depth);
+	Vec3 center;
+	center.x = (compact(code) + 0.5f) * cell - 0.5f*this->size;
+	center.y = (compact(code >> 1) + 0.5f) * cell - 0.5f*this->size;
+	center.z = (compact(code >> 2) + 0.5f) * cell;
+	return center;
+}
+
+/** Return half the width of a node. */
+float LinearVolume::getSize(const Node *node) const
+{
+	return 0.5f * this->size / (1u << getCodeDepth(node->code));
+}
+
+size_t LinearVolume::getNodeCount() const
+{
+	return this->nodes.size();
+}
+
+/** Returns the number of bytes reserved for nodes. Nodes are found
+through their codes, so there is no other storage. */
+size_t LinearVolume::getByteCount() const
+{
+	return this->nodes.capacity() * sizeof(Node);
+}
+
+/** The children of a node are added in Morton order. */
+size_t LinearVolume::divide(size_t index)
+{
+	size_t first = this->nodes.size();
+	uint64_t code = this->nodes[index].code << 3;
+	for (uint64_t i = 0; i < 8; i++)
+		this->nodes.push_back(Node(code | i));
+	this->nodes[index].children = static_cast<uint32_t>(first);
+	return first;
+}
+
+/** Points outside of the volume are moved to the nearest boundary node. */
+size_t LinearVolume::getIndex(Vec3 point, int depth, bool divide)
+{
+	int levels = this->depth;
+	float cell = this->size / (1u << levels);
+	float min = -0.5f*this->size;
+	uint32_t x = toCoordinate(point.x, min, cell, levels);
+	uint32_t y = toCoordinate(point.y, min, cell, levels);
+	uint32_t z = toCoordinate(point.z, 0.0f, cell, levels);
+
+	size_t index = 0;
+	for (int d = 0; d < levels && d < depth; d++) {
+		size_t first = this->nodes[index].children;
+		if (!first && !divide)
+			break;
+		else if (!first)
+			first = this->divide(index);
+		int shift = levels - d - 1;
+		uint32_t child = (x >> shift) & 1;
+		child |= ((y >> shift) & 1) << 1;
+		child |= ((z >> shift) & 1) << 2;
+		index = first + child;
+	}
+	return index;
+}
+
+size_t LinearVolume::getIndex(uint64_t code) const
+{
+	size_t index = getAncestorIndex(code);
+	return this->nodes[index].code == code ? index : none;
+}
+
+/** Return the deepest node that contains the node of a code. The children
+of a node are stored in Morton order, so every three bits of the code are
+the offset of a child. */
+size_t LinearVolume::getAncestorIndex(uint64_t code) const
+{
+	size_t index = 0;
+	int d = getCodeDepth(code);
+	while (d-- > 0 && this->nodes[index].children) {
+		size_t first = this->nodes[index].children;
+		index = first + ((code >> 3*d) & 7);
+	}
+	return index;
+}
+
+/** Descend to the child of a node that contains a point on the face that
+a ray entered through. The axis is the normal of the face. */
+size_t LinearVolume::getChildIndex(
+	size_t index, Vec3 point, int axis, bool positive, int depth,
+	bool divide)
+{
+	const float p[3] = {point.x, point.y, point.z};
+	int d = getCodeDepth(this->nodes[index].code);
+	while (d < depth && d < this->depth) {
+		size_t first = this->nodes[index].children;
+		if (!first && !divide)
+			break;
+		else if (!first)
+			first = this->divide(index);
+		Vec3 center = getCenter(&this->nodes[index]);
+		const float c[3] = {center.x, center.y, center.z};
+		uint32_t child = 0;
+		for (int i = 0; i < 3; i++) {
+			if (i == axis ? !positive : p[i] >= c[i])
+				child |= 1 << i;
+		}
+		index = first + child;
+		d++;
+	}
+	return index;
+}
+
+/** Return the code of the neighbour at the same depth or zero if the
+neighbour is outside of the volume. Adding or subtracting one from a
+coordinate is done on the interleaved bits directly. */
+uint64_t LinearVolume::getAdjacentCode(
+	uint64_t code, int axis, bool positive) const
+{
+	int depth = getCodeDepth(code);
+	uint64_t level = 1ull << 3*depth;
+	uint64_t mask = (xBits << axis) & (level - 1);
+	uint64_t m = code & (level - 1);
+	if (positive) {
+		if ((m & mask) == mask)
+			return 0;
+		m = (((m | ~mask) + 1) & mask) | (m & ~mask);
+	} else {
+		if ((m & mask) == 0)
+			return 0;
+		m = (((m & mask) - 1) & mask) | (m & ~mask);
+	}
+	return level | m;
+}
+
+/** Return the axis of the face that a ray leaves a node through. */
+int LinearVolume::getAdjacentAxis(uint64_t code, Ray ray, float &t) const
+{
+	Node node(code);
+	Vec3 center = getCenter(&node);
+	float size = getSize(&node);
+	const float o[3] = {ray.origin.x, ray.origin.y, ray.origin.z};
+	const float d[3] = {ray.direction.x, ray.direction.y, ray.direction.z};
+	const float c[3] = {center.x, center.y, center.z};
+	int axis = 0;
+	t = std::numeric_limits<float>::max();
+	for (int i = 0; i < 3; i++) {
+		float s;
+		if (d[i] > 0.0f)
+			s = (c[i] + size - o[i]) / d[i];
+		else if (d[i] < 0.0f)
+			s = (c[i] - size - o[i]) / d[i];
+		else
+			continue;
+		if (s < t) {
+			t = s;
+			axis = i;
+		}
+	}
+	return axis;
+}
+
+size_t LinearVolume::getAdjacentIndex(
+	size_t index, Ray ray, int depth, bool divide)
+{
+	float t;
+	uint64_t code = this->nodes[index].code;
+	int axis = getAdjacentAxis(code, ray, t);
+	const float d[3] = {ray.direction.x, ray.direction.y, ray.direction.z};
+	bool positive = d[axis] > 0.0f;
+	uint64_t adjacentCode = getAdjacentCode(code, axis, positive);
+	if (!adjacentCode || d[axis] == 0.0f)
+		return index;
+
+	/* The neighbour is either a leaf at a lower depth or a node that
+	needs to be descended into. */
+	size_t adjacentIndex = getAncestorIndex(adjacentCode);
+	Vec3 point = ray.origin + t*ray.direction;
+	return getChildIndex(
+		adjacentIndex, point, axis, positive, depth, divide);
+}
+
+Node::Node(uint64_t code) :
+	code(code),
+	direction(0.0f, 0.0f, 0.0f),
+	density(0.0f),
+	quantity(0),
+	children(0)
+{
+
+}
+
+uint64_t Node::getCode() const
+{
+	return this->code;
+}
+
+int Node::getDepth() const
+{
+	return getCodeDepth(this->code);
+}
+
+bool Node::isLeaf() const
+{
+	return this->children == 0;
+}
+
+void Node::setDensity(float density)
+{
+	this->density = density;
+}
+
+float Node::getDensity() const
+{
+	return this->density;
+}
+
+void Node::setDirection(Vec3 direction)
+{
+	this->direction = direction;
+}
+
+Vec3 Node::getDirection() const
+{
+	return this->direction;
+}
+
+void Node::setQuantity(int quantity)
+{
+	this->quantity = quantity;
+}
+
+int Node::getQuantity() const
+{
+	return this->quantity;
+}
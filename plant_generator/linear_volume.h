@@ -0,0 +1,89 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PG_LINEAR_VOLUME_H
+#define PG_LINEAR_VOLUME_H
+
+#include "math/intersection.h"
+#include "math/vec3.h"
+#include <cstdint>
+#include <vector>
+
+#define PG_LINEAR_VOLUME_MAX_DEPTH 20
+
+namespace pg {
+	/** An octree without pointers. Nodes are identified by a Morton code
+	with a leading bit that marks the depth of the node. The children of a
+	node are stored next to each other in Morton order, and parents and
+	neighbours are found by manipulating the bits of the code. Node
+	pointers are invalidated when a node is divided. */
+	class LinearVolume {
+	public:
+		class Node {
+			uint64_t code;
+			Vec3 direction;
+			float density;
+			int quantity;
+			uint32_t children;
+
+			friend class LinearVolume;
+
+		public:
+			Node(uint64_t code = 1);
+			uint64_t getCode() const;
+			int getDepth() const;
+			bool isLeaf() const;
+
+			void setDensity(float density);
+			float getDensity() const;
+			void setDirection(Vec3 direction);
+			Vec3 getDirection() const;
+			void setQuantity(int quantity);
+			int getQuantity() const;
+		};
+
+		LinearVolume(float size = 1.0f, int depth = 1);
+		void clear(float size, int depth);
+		Node *addNode(Vec3 point, int depth = 1000);
+		void addLine(Vec3 a, Vec3 b, float weight, float radius);
+		Node *getNode(Vec3 point);
+		Node *getNode(uint64_t code);
+		Node *getParent(const Node *node);
+		Node *getChild(const Node *node, int index);
+		Node *getAdjacentNode(
+			const Node *node, Ray ray, int depth = 1000);
+		Node *getRoot();
+		Vec3 getCenter(const Node *node) const;
+		float getSize(const Node *node) const;
+		size_t getNodeCount() const;
+		size_t getByteCount() const;
+
+	private:
+		float size;
+		int depth;
+		std::vector<Node> nodes;
+
+		size_t divide(size_t index);
+		size_t getIndex(Vec3 point, int depth, bool divide);
+		size_t getIndex(uint64_t code) const;
+		size_t getAncestorIndex(uint64_t code) const;
+		size_t getChildIndex(size_t, Vec3, int, bool, int, bool);
+		uint64_t getAdjacentCode(uint64_t, int, bool) const;
+		int getAdjacentAxis(uint64_t code, Ray ray, float &t) const;
+		size_t getAdjacentIndex(size_t, Ray, int, bool);
+	};
+}
+
+#endif
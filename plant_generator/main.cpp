@@ -16,30 +16,308 @@
 #include "generator.h"
 #include "pattern_generator.h"
 #include "mesh.h"
+#include "obstacles.h"
 #include "scene.h"
 #include "file/wavefront.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <iostream>
 #include <fstream>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 #include <boost/program_options.hpp>
 
+#ifdef PG_SERIALIZE
+#include <boost/archive/text_iarchive.hpp>
+#endif
+
 namespace po = boost::program_options;
 
+typedef std::chrono::steady_clock Clock;
+typedef std::vector<std::string> Names;
+
+/* The settings that are shared by every plant of a batch. */
+struct Settings {
+	int cycles;
+	int nodes;
+	int rays;
+	int divisions;
+	float tolerance;
+	float pgr;
+	float sgr;
+	int threads;
+	const pg::Obstacles *obstacles;
+};
+
+/* A plant of a batch. Plants with a parameter file are grown again from
+the parameter tree of the saved plant. */
+struct Item {
+	std::string name;
+	std::string filename;
+	unsigned seed;
+	bool seeded;
+};
+
+bool endsWith(const std::string &string, const std::string &suffix)
+{
+	return string.size() > suffix.size() &&
+		std::equal(suffix.rbegin(), suffix.rend(), string.rbegin());
+}
+
+/* Seeds are either single numbers or inclusive ranges such as 10-19. */
+bool addSeeds(const std::string &value, std::vector<unsigned> &seeds)
+{
+	try {
+		size_t index = value.find('-');
+		if (index == std::string::npos) {
+			seeds.push_back(std::stoul(value));
+			return true;
+		}
+		unsigned first = std::stoul(value.substr(0, index));
+		unsigned last = std::stoul(value.substr(index + 1));
+		for (unsigned seed = first; seed <= last; seed++)
+			seeds.push_back(seed);
+		return first <= last;
+	} catch (std::exception &) {
+		return false;
+	}
+}
+
+std::string getStem(const std::string &filename)
+{
+	size_t start = filename.find_last_of("/\\");
+	start = start == std::string::npos ? 0 : start + 1;
+	size_t end = filename.find_last_of('.');
+	if (end == std::string::npos || end < start)
+		end = filename.size();
+	return filename.substr(start, end - start);
+}
+
+std::vector<Item> getItems(
+	const std::vector<std::string> &filenames,
+	const std::vector<unsigned> &seeds)
+{
+	std::vector<Item> items;
+	if (filenames.empty()) {
+		for (unsigned seed : seeds)
+			items.push_back({std::to_string(seed), "", seed, true});
+	} else if (seeds.empty()) {
+		for (const std::string &filename : filenames) {
+			std::string name = getStem(filename);
+			items.push_back({name, filename, 0, false});
+		}
+	} else {
+		for (const std::string &filename : filenames)
+			for (unsigned seed : seeds) {
+				std::string name = getStem(filename);
+				name += "_" + std::to_string(seed);
+				items.push_back({name, filename, seed, true});
+			}
+	}
+	return items;
+}
+
+/* Every occurrence of {} in the pattern is replaced with the name of the
+plant. The name is appended if the pattern has no {}. */
+std::string getOutputName(const std::string &pattern, const Item &item)
+{
+	std::string name = pattern;
+	size_t index = name.find("{}");
+	if (index == std::string::npos)
+		return name + "_" + item.name;
+	while (index != std::string::npos) {
+		name.replace(index, 2, item.name);
+		index = name.find("{}", index + item.name.size());
+	}
+	return name;
+}
+
+bool load(pg::Scene &scene, const std::string &filename)
+{
+#ifdef PG_SERIALIZE
+	try {
+		std::ifstream stream(filename);
+		if (!stream.good())
+			return false;
+		boost::archive::text_iarchive ia(stream);
+		ia >> scene;
+		return true;
+	} catch (std::exception &) {
+		return false;
+	}
+#else
+	return false;
+#endif
+}
+
+/* Returns false if the plant was not generated from parameters. */
+bool growPattern(pg::Scene &scene, const Settings &settings, const Item &item)
+{
+	pg::Stem *stem = scene.plant.getRoot();
+	if (!stem)
+		return false;
+	pg::ParameterTree tree = stem->getParameterTree();
+	pg::ParameterNode *root = tree.getRoot();
+	if (!root)
+		return false;
+	if (item.seeded) {
+		pg::StemData data = root->getData();
+		data.seed = item.seed;
+		root->setData(data);
+	}
+
+	pg::PatternGenerator generator(&scene.plant);
+	generator.threads = settings.threads;
+	generator.setParameterTree(tree);
+	generator.grow();
+	return true;
+}
+
+void grow(pg::Scene &scene, const Settings &settings, unsigned seed)
+{
+	scene.plant.setDefault();
+	pg::Generator generator(&scene.plant);
+	generator.primaryGrowthRate = settings.pgr;
+	generator.secondaryGrowthRate = settings.sgr;
+	generator.rays = settings.rays;
+	generator.skyDivisions = settings.divisions;
+	generator.cycles = settings.cycles;
+	generator.nodes = settings.nodes;
+	generator.seed = seed;
+	generator.threads = settings.threads;
+	generator.obstacles = settings.obstacles;
+	generator.grow();
+}
+
+/* Curves of stems are sampled with fewer points where they are nearly
+straight. */
+void subdivide(pg::Stem *stem, float tolerance)
+{
+	pg::Path path = stem->getPath();
+	path.subdivide(tolerance);
+	stem->setPath(path);
+	pg::Stem *child = stem->getChild();
+	while (child) {
+		subdivide(child, tolerance);
+		child = child->getSibling();
+	}
+}
+
+void save(const pg::Scene &scene, const pg::Mesh &mesh, std::string filename)
+{
+	pg::Wavefront obj;
+	obj.exportFile(filename + ".obj", mesh, scene.plant);
+
+#ifdef PG_SERIALIZE
+	std::ofstream stream(filename + ".plant");
+	if (stream.good()) {
+		boost::archive::text_oarchive oa(stream);
+		oa << scene;
+	}
+	stream.close();
+#endif
+}
+
+/* Plants are taken from the list by a fixed number of workers, so only one
+scene per worker is kept in memory. */
+int generate(
+	const std::vector<Item> &items, const Settings &settings, int jobs,
+	const std::string &pattern, bool single)
+{
+	std::mutex mutex;
+	std::atomic<size_t> next(0);
+	std::atomic<size_t> failures(0);
+	auto start = Clock::now();
+
+	auto work = [&] () {
+		size_t index;
+		while ((index = next++) < items.size()) {
+			const Item &item = items[index];
+			auto t1 = Clock::now();
+			pg::Scene scene;
+			std::string error;
+			if (item.filename.empty())
+				grow(scene, settings, item.seed);
+			else if (!load(scene, item.filename))
+				error = "Could not load ";
+			else if (!growPattern(scene, settings, item))
+				error = "No parameters in ";
+			if (!error.empty()) {
+				std::lock_guard<std::mutex> lock(mutex);
+				std::cerr << error << item.filename
+					<< std::endl;
+				failures++;
+				continue;
+			}
+			pg::Stem *root = scene.plant.getRoot();
+			if (root && settings.tolerance > 0.0f)
+				subdivide(root, settings.tolerance);
+			auto t2 = Clock::now();
+			pg::Mesh mesh(&scene.plant);
+			mesh.generate();
+			auto t3 = Clock::now();
+			std::string filename = pattern;
+			if (!single)
+				filename = getOutputName(pattern, item);
+			save(scene, mesh, filename);
+			auto t4 = Clock::now();
+
+			std::chrono::duration<double> d1 = t2 - t1;
+			std::chrono::duration<double> d2 = t3 - t2;
+			std::chrono::duration<double> d3 = t4 - t3;
+			std::lock_guard<std::mutex> lock(mutex);
+			std::cout << item.name << ": grow " << d1.count()
+				<< " s, mesh " << d2.count() << " s, export "
+				<< d3.count() << " s, "
+				<< mesh.getVertexCount() << " vertices"
+				<< std::endl;
+		}
+	};
+
+	if (jobs > static_cast<int>(items.size()))
+		jobs = items.size();
+	std::vector<std::thread> workers;
+	for (int i = 1; i < jobs; i++)
+		workers.emplace_back(work);
+	work();
+	for (std::thread &worker : workers)
+		worker.join();
+
+	std::chrono::duration<double> duration = Clock::now() - start;
+	size_t count = items.size() - failures;
+	std::cout << count << " plants in " << duration.count() << " s ("
+		<< count / duration.count() << " plants/s)" << std::endl;
+	return failures > 0 ? 1 : 0;
+}
+
 int main(int argc, char **argv)
 {
-	int cycles = 5;
-	int nodes = 4;
-	int rays = 100;
-	int divisions = 100;
-	float pgr = 0.5f;
-	float sgr = 0.005f;
+	Settings settings;
+	settings.cycles = 5;
+	settings.nodes = 4;
+	settings.rays = 10000;
+	settings.divisions = 10;
+	settings.tolerance = 0.0f;
+	settings.pgr = 0.5f;
+	settings.sgr = 0.005f;
+	settings.obstacles = nullptr;
+	int jobs = 1;
+	float cellSize = 0.1f;
 	std::string filename = "saved/default";
+	std::string obstaclesFilename;
+	std::string cacheFilename;
+	std::vector<std::string> filenames;
+	std::vector<unsigned> seeds;
 
 	po::options_description desc("Options");
 	desc.add_options()
 		("help,h", "show help")
 		("out,o", po::value<std::string>(),
-		"set the name of the output file")
+		"set the name of the output file or the pattern of the names "
+		"of a batch, where {} is replaced with the name of the plant")
 		("nodes,n", po::value<int>(),
 		"set the maximum number of nodes per cycle")
 		("primary-growth-rate,p", po::value<float>(),
@@ -47,15 +325,34 @@ int main(int argc, char **argv)
 		("secondary-growth-rate,s", po::value<float>(),
 		"set the average increase in radius")
 		("rays,r", po::value<int>(),
-		"the maximum number of rays at any height")
+		"set the number of rays cast for each node")
 		("sky-divisions,d", po::value<int>(),
-		"the number of height increments of the sky")
+		"set the number of rings of the sky dome")
 		("cycles,c", po::value<int>(), "set the number of cycles")
+		("path-tolerance", po::value<float>(),
+		"set the distance that paths of stems can deviate from their "
+		"curves, where zero keeps the divisions of each stem")
+		("obstacles,b", po::value<std::string>(),
+		"load obstacles from an .obj file or from saved cells")
+		("cell-size", po::value<float>(),
+		"set the width of the cells of obstacles")
+		("save-obstacles", po::value<std::string>(),
+		"save the cells of obstacles to a file")
+		("seeds,e", po::value<Names>()->multitoken(),
+		"generate a plant for each seed or range of seeds, e.g. 1 5-9")
+		("plants,P", po::value<Names>()->multitoken(),
+		"grow plants again from the parameters of .plant files")
+		("jobs,j", po::value<int>(),
+		"set the number of plants that are generated at once, where "
+		"zero uses all hardware threads")
 	;
+	po::positional_options_description positional;
+	positional.add("plants", -1);
 
 	try {
 		po::variables_map vm;
-		po::store(po::parse_command_line(argc, argv, desc), vm);
+		po::store(po::command_line_parser(argc, argv).options(desc)
+			.positional(positional).run(), vm);
 		po::notify(vm);
 
 		if (vm.count("help")) {
@@ -63,82 +360,76 @@ int main(int argc, char **argv)
 			return 0;
 		}
 		if (vm.count("cycles"))
-			cycles = vm["cycles"].as<int>();
+			settings.cycles = vm["cycles"].as<int>();
 		if (vm.count("nodes"))
-			nodes = vm["nodes"].as<int>();
+			settings.nodes = vm["nodes"].as<int>();
 		if (vm.count("primary-growth-rate"))
-			pgr = vm["primary-growth-rate"].as<float>();
+			settings.pgr = vm["primary-growth-rate"].as<float>();
 		if (vm.count("secondary-growth-rate"))
-			sgr = vm["secondary-growth-rate"].as<float>();
+			settings.sgr = vm["secondary-growth-rate"].as<float>();
 		if (vm.count("rays"))
-			rays = vm["rays"].as<int>();
+			settings.rays = vm["rays"].as<int>();
 		if (vm.count("sky-divisions"))
-			divisions = vm["sky-divisions"].as<int>();
+			settings.divisions = vm["sky-divisions"].as<int>();
+		if (vm.count("path-tolerance")) {
+			float tolerance = vm["path-tolerance"].as<float>();
+			settings.tolerance = tolerance;
+		}
 		if (vm.count("out"))
 			filename = vm["out"].as<std::string>();
+		if (vm.count("obstacles"))
+			obstaclesFilename = vm["obstacles"].as<std::string>();
+		if (vm.count("cell-size"))
+			cellSize = vm["cell-size"].as<float>();
+		if (vm.count("save-obstacles"))
+			cacheFilename = vm["save-obstacles"].as<std::string>();
+		if (vm.count("plants"))
+			filenames = vm["plants"].as<Names>();
+		if (vm.count("jobs"))
+			jobs = vm["jobs"].as<int>();
+		if (vm.count("seeds")) {
+			for (const std::string &seed : vm["seeds"].as<Names>())
+				if (!addSeeds(seed, seeds))
+					throw po::invalid_option_value(seed);
+		}
 	} catch (std::exception &exc) {
 		std::cerr << exc.what() << std::endl;
 		return 1;
 	}
 
-	pg::Scene scene;
-	scene.plant.setDefault();
-
-#ifndef PATTERN_GENERATOR
-	pg::Generator generator(&scene.plant);
-	generator.primaryGrowthRate = pgr;
-	generator.secondaryGrowthRate = sgr;
-	generator.rayCount = rays;
-	generator.rayLevels = divisions;
-	generator.cycles = cycles;
-	generator.nodes = nodes;
-	generator.grow();
-#else
-	pg::PatternGenerator generator(&scene.plant);
-	pg::ParameterTree tree = generator.getParameterTree();
-	pg::ParameterNode *root = tree.createRoot();
-	std::random_device rd;
-	root->setSeed(rd());
-	pg::ParameterNode *node1 = tree.addChild("");
-	pg::StemData data;
-	data.density = 1.0f;
-	data.densityCurve.setDefault(1);
-	data.start = 2.0f;
-	data.scale = 0.8f;
-	data.length = 50.0f;
-	data.radiusThreshold = 0.02f;
-	data.leaf.scale = pg::Vec3(1.0f, 1.0f, 1.0f);
-	data.leaf.density = 3.0f;
-	data.leaf.densityCurve.setDefault(1);
-	data.leaf.distance = 3.0f;
-	data.leaf.rotation = 3.141f;
-	node1->setData(data);
-	pg::ParameterNode *node2 = tree.addChild("1");
-	data.start = 1.0f;
-	data.radiusThreshold = 0.01f;
-	data.angleVariation = 0.2f;
-	node2->setData(data);
-	pg::ParameterNode *node3 = tree.addChild("1.1");
-	data.density = 0.0f;
-	node3->setData(data);
-	generator.setParameterTree(tree);
-	generator.grow();
-#endif
-
-	pg::Mesh mesh(&scene.plant);
-	mesh.generate();
-
-	pg::Wavefront obj;
-	obj.exportFile((filename + ".obj").c_str(), mesh, scene.plant);
-
-#ifdef PG_SERIALIZE
-	std::ofstream stream(filename + ".plant");
-	if (stream.good()) {
-		boost::archive::text_oarchive oa(stream);
-		oa << scene;
+	/* Meshes are voxelized once, and the cells can be saved so that later
+	runs do not need to voxelize them again. */
+	pg::Obstacles obstacles;
+	if (endsWith(obstaclesFilename, ".obj")) {
+		pg::Geometry geometry;
+		pg::Wavefront obj;
+		obj.importFile(obstaclesFilename.c_str(), &geometry);
+		obstacles.setGeometry(geometry, cellSize);
+	} else if (!obstaclesFilename.empty() &&
+		!obstacles.load(obstaclesFilename.c_str())) {
+		std::cerr << "Could not load " << obstaclesFilename << std::endl;
+		return 1;
 	}
-	stream.close();
-#endif
+	if (!cacheFilename.empty() &&
+		!obstacles.save(cacheFilename.c_str())) {
+		std::cerr << "Could not save " << cacheFilename << std::endl;
+		return 1;
+	}
+	if (obstacles.getCellCount() > 0)
+		settings.obstacles = &obstacles;
+
+	/* The hardware threads are divided between the plants that are
+	generated at the same time. */
+	int hardwareThreads = std::thread::hardware_concurrency();
+	if (jobs <= 0)
+		jobs = hardwareThreads;
+	settings.threads = std::max(hardwareThreads / std::max(jobs, 1), 1);
 
-	return 0;
+	bool single = filenames.empty() && seeds.empty();
+	std::vector<Item> items;
+	if (single)
+		items.push_back({"0", "", 0, false});
+	else
+		items = getItems(filenames, seeds);
+	return generate(items, settings, jobs, filename, single);
 }
@@ -19,39 +19,46 @@
 
 using pg::Vec3;
 
-int factorial(int n)
-{
-	int r = 1;
-	for (int i = n; i > 0; i--)
-		r *= i;
-	return r;
-}
-
-float getBernsteinTerm(float t, int i, int n)
-{
-	float a = (float)factorial(n)/(factorial(i) * factorial(n - i));
-	float b = pow(t, i) * pow(1.0f - t, n - i);
-	return a * b;
-}
+using pg::BezierStepper;
 
+/* The binomial coefficients are updated from one term to the next instead
+of being computed from factorials, which overflow for large degrees. */
 Vec3 getOtherBezier(float t, const Vec3 *points, int size)
 {
 	Vec3 b(0.0f, 0.0f, 0.0f);
+	int n = size - 1;
+	float coefficient = 1.0f;
 	for (int i = 0; i < size; i++) {
-		float basis = getBernsteinTerm(t, i, size-1);
+		float basis = coefficient * pow(t, i) * pow(1.0f - t, n - i);
 		b += basis * points[i];
+		coefficient = coefficient * (n - i) / (i + 1);
 	}
 	return b;
 }
 
 Vec3 pg::getBezier(float t, const Vec3 *p, int size)
 {
-	if (size == 4)
+	switch (size) {
+	case 4:
 		return getCubicBezier(t, p[0], p[1], p[2], p[3]);
-	if (size == 2)
+	case 3:
+		return getQuadraticBezier(t, p[0], p[1], p[2]);
+	case 2:
 		return getLinearBezier(t, p[0], p[1]);
-	else
+	case 1:
+		return p[0];
+	default:
 		return getOtherBezier(t, p, size);
+	}
+}
+
+void pg::getBezier(
+	const Vec3 *points, int size, float start, float delta, int count,
+	Vec3 *result)
+{
+	BezierStepper stepper(points, size, start, delta);
+	for (int i = 0; i < count; i++)
+		result[i] = stepper.next();
 }
 
 Vec3 pg::getLinearBezier(float t, Vec3 x, Vec3 y)
@@ -82,3 +89,54 @@ Vec3 pg::getCubicBezier(float t, Vec3 x, Vec3 y, Vec3 z, Vec3 w)
 	b += (t*t*t) * w;
 	return b;
 }
+
+/** The curve is converted to a polynomial and the forward differences are
+derived from its coefficients. Differences of evaluated points would lose
+most of their precision for small steps. */
+BezierStepper::BezierStepper(
+	const Vec3 *points, int size, float start, float delta) :
+	points(points),
+	size(size),
+	t(start),
+	delta(delta)
+{
+	if (size > 4)
+		return;
+
+	/* Coefficients in increasing powers of t. */
+	const Vec3 zero(0.0f, 0.0f, 0.0f);
+	Vec3 c[4] = {zero, zero, zero, zero};
+	const Vec3 *p = points;
+	if (size == 4) {
+		c[1] = 3.0f * (p[1] - p[0]);
+		c[2] = 3.0f * (p[0] - 2.0f * p[1] + p[2]);
+		c[3] = p[3] - p[0] + 3.0f * (p[1] - p[2]);
+	} else if (size == 3) {
+		c[1] = 2.0f * (p[1] - p[0]);
+		c[2] = p[0] - 2.0f * p[1] + p[2];
+	} else if (size == 2)
+		c[1] = p[1] - p[0];
+
+	float h = delta;
+	float s = start;
+	this->differences[0] = getBezier(start, points, size);
+	this->differences[1] = (3.0f*s*s*h + 3.0f*s*h*h + h*h*h) * c[3];
+	this->differences[1] += (2.0f*s*h + h*h) * c[2] + h * c[1];
+	this->differences[2] = (6.0f*s*h*h + 6.0f*h*h*h) * c[3];
+	this->differences[2] += (2.0f*h*h) * c[2];
+	this->differences[3] = (6.0f*h*h*h) * c[3];
+}
+
+Vec3 BezierStepper::next()
+{
+	if (this->size > 4) {
+		Vec3 point = getBezier(this->t, this->points, this->size);
+		this->t += this->delta;
+		return point;
+	}
+
+	Vec3 point = this->differences[0];
+	for (int i = 1; i < this->size; i++)
+		this->differences[i-1] += this->differences[i];
+	return point;
+}
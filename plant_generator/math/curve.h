@@ -25,6 +25,29 @@ namespace pg {
 	Vec3 getLinearBezier(float t, Vec3 x, Vec3 y);
 	Vec3 getQuadraticBezier(float t, Vec3 x, Vec3 y, Vec3 z);
 	Vec3 getCubicBezier(float t, Vec3 x, Vec3 y, Vec3 z, Vec3 w);
+	/** Evaluate a curve at count parameters that start at start and
+	are delta apart. */
+	void getBezier(
+		const Vec3 *points, int size, float start, float delta,
+		int count, Vec3 *result);
+
+	/** Steps along a Bezier curve at evenly spaced parameters. Curves
+	of degree three or lower are evaluated with forward differences, which
+	costs one addition per degree for each point. Higher degrees are
+	evaluated directly. */
+	class BezierStepper {
+		Vec3 differences[4];
+		const Vec3 *points;
+		int size;
+		float t;
+		float delta;
+
+	public:
+		BezierStepper(
+			const Vec3 *points, int size, float start, float delta);
+		/** Return the current point and advance to the next one. */
+		Vec3 next();
+	};
 }
 
 #endif
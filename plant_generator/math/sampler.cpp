@@ -0,0 +1,186 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sampler.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+using pg::Sampler;
+
+const int primes[PG_SAMPLER_DIMENSIONS] = {2, 3, 5, 7};
+
+/* Direction numbers of the first dimensions of a Sobol sequence from the
+primitive polynomials x, x+1, x^2+x+1 and x^3+x+1. */
+struct SobolDirections {
+	uint32_t v[PG_SAMPLER_DIMENSIONS][32];
+
+	SobolDirections()
+	{
+		const int s[PG_SAMPLER_DIMENSIONS] = {0, 1, 2, 3};
+		const int a[PG_SAMPLER_DIMENSIONS] = {0, 0, 1, 1};
+		const uint32_t m[PG_SAMPLER_DIMENSIONS][3] = {
+			{0, 0, 0}, {1, 0, 0}, {1, 3, 0}, {1, 3, 1}};
+		for (int k = 0; k < 32; k++)
+			v[0][k] = 1u << (31-k);
+		for (int d = 1; d < PG_SAMPLER_DIMENSIONS; d++) {
+			for (int k = 0; k < s[d]; k++)
+				v[d][k] = m[d][k] << (31-k);
+			for (int k = s[d]; k < 32; k++) {
+				v[d][k] = v[d][k-s[d]] ^ (v[d][k-s[d]] >> s[d]);
+				for (int j = 1; j < s[d]; j++)
+					if ((a[d] >> (s[d]-1-j)) & 1)
+						v[d][k] ^= v[d][k-j];
+			}
+		}
+	}
+};
+
+const SobolDirections sobolDirections;
+
+static uint64_t hash(uint64_t x)
+{
+	x += 0x9e3779b97f4a7c15ull;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+	return x ^ (x >> 31);
+}
+
+/* Only the upper 24 bits are kept so that the value is less than one. */
+static float toUnitInterval(uint32_t bits)
+{
+	return (bits >> 8) * (1.0f / 16777216.0f);
+}
+
+static float getRadicalInverse(unsigned index, unsigned base)
+{
+	float inverse = 1.0f / base;
+	float factor = inverse;
+	float value = 0.0f;
+	while (index > 0) {
+		value += (index % base) * factor;
+		index /= base;
+		factor *= inverse;
+	}
+	return value;
+}
+
+Sampler::Sampler(Type type, int size, unsigned seed) :
+	type(type),
+	size(size),
+	strata(std::sqrt(size)),
+	seed(seed)
+{
+	std::mt19937 mt(seed);
+	std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+	for (int i = 0; i < PG_SAMPLER_DIMENSIONS; i++) {
+		this->scrambles[i] = mt();
+		this->shifts[i] = dis(mt);
+	}
+	/* The strata of the origins and of the directions are visited in
+	random orders, so that the samples of a run that stops early are
+	still spread over the grid, and so that they are paired randomly. */
+	if (type == Stratified) {
+		this->origins.resize(size);
+		this->directions.resize(size);
+		for (int i = 0; i < size; i++) {
+			this->origins[i] = i;
+			this->directions[i] = i;
+		}
+		std::vector<int> &origins = this->origins;
+		std::vector<int> &directions = this->directions;
+		std::shuffle(origins.begin(), origins.end(), mt);
+		std::shuffle(directions.begin(), directions.end(), mt);
+	}
+}
+
+Sampler::Type Sampler::getType() const
+{
+	return this->type;
+}
+
+int Sampler::getSize() const
+{
+	return this->size;
+}
+
+void Sampler::getSample(int index, float *sample) const
+{
+	switch (this->type) {
+	case Stratified:
+		getStratifiedSample(index, sample);
+		break;
+	case Halton:
+		getHaltonSample(index, sample);
+		break;
+	case Sobol:
+		getSobolSample(index, sample);
+		break;
+	default:
+		for (int i = 0; i < PG_SAMPLER_DIMENSIONS; i++)
+			sample[i] = getRandom(index, i);
+	}
+}
+
+float Sampler::getRandom(int index, int dimension) const
+{
+	uint64_t key = static_cast<uint64_t>(index)*PG_SAMPLER_DIMENSIONS;
+	return toUnitInterval(hash(hash(this->seed) + key + dimension) >> 32);
+}
+
+/** The first two and last two dimensions are each divided into a grid of
+cells and each sample is jittered inside of a cell. Samples that do not fit
+in the grid are random. */
+void Sampler::getStratifiedSample(int index, float *sample) const
+{
+	int strata = this->strata;
+	int indices[2] = {this->origins[index], this->directions[index]};
+	for (int i = 0; i < 2; i++) {
+		float *s = &sample[2*i];
+		s[0] = getRandom(index, 2*i);
+		s[1] = getRandom(index, 2*i+1);
+		if (indices[i] < strata * strata) {
+			s[0] = (indices[i] % strata + s[0]) / strata;
+			s[1] = (indices[i] / strata + s[1]) / strata;
+			s[0] = std::min(s[0], 0.99999994f);
+			s[1] = std::min(s[1], 0.99999994f);
+		}
+	}
+}
+
+/** The sequence is scrambled by shifting it by a random offset. */
+void Sampler::getHaltonSample(int index, float *sample) const
+{
+	for (int i = 0; i < PG_SAMPLER_DIMENSIONS; i++) {
+		float value = getRadicalInverse(index + 1, primes[i]);
+		value += this->shifts[i];
+		if (value >= 1.0f)
+			value -= 1.0f;
+		sample[i] = std::min(value, 0.99999994f);
+	}
+}
+
+/** The sequence is scrambled with a random digital shift. */
+void Sampler::getSobolSample(int index, float *sample) const
+{
+	for (int i = 0; i < PG_SAMPLER_DIMENSIONS; i++) {
+		uint32_t bits = this->scrambles[i];
+		uint32_t n = static_cast<uint32_t>(index);
+		for (int k = 0; n > 0; k++, n >>= 1)
+			if (n & 1)
+				bits ^= sobolDirections.v[i][k];
+		sample[i] = toUnitInterval(bits);
+	}
+}
@@ -0,0 +1,56 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PG_SAMPLER_H
+#define PG_SAMPLER_H
+
+#include <cstdint>
+#include <vector>
+
+#define PG_SAMPLER_DIMENSIONS 4
+
+namespace pg {
+	/** Generates points in a four dimensional unit hypercube. Samples are
+	identified by an index so that they can be generated in any order on
+	any thread. The low-discrepancy sequences are scrambled with the seed
+	so that every seed produces a different set of points. */
+	class Sampler {
+	public:
+		enum Type {Random, Stratified, Halton, Sobol};
+
+		Sampler(Type type, int size, unsigned seed);
+		Type getType() const;
+		int getSize() const;
+		/** Each coordinate is in the interval [0, 1). */
+		void getSample(int index, float *sample) const;
+
+	private:
+		Type type;
+		int size;
+		int strata;
+		uint64_t seed;
+		uint32_t scrambles[PG_SAMPLER_DIMENSIONS];
+		float shifts[PG_SAMPLER_DIMENSIONS];
+		std::vector<int> origins;
+		std::vector<int> directions;
+
+		float getRandom(int index, int dimension) const;
+		void getStratifiedSample(int, float *) const;
+		void getHaltonSample(int, float *) const;
+		void getSobolSample(int, float *) const;
+	};
+}
+
+#endif
@@ -33,6 +33,7 @@ void Mesh::generate()
 {
 	Stem *stem = this->plant->getRoot();
 	initBuffer();
+	this->plant->updateLocations();
 	if (stem) {
 		State parentState = {};
 		State state;
@@ -116,11 +117,18 @@ void Mesh::addChildStems(Stem *stem, Stem *fork[2], State &state)
 	}
 }
 
+/* Return the number of points in the last curve of a path excluding its
+ends. */
+int getLastDivisions(const Path &path)
+{
+	return path.getCurveDivisions(path.getSpline().getCurveCount() - 1);
+}
+
 size_t getSectionCount(Stem *stem, Stem *fork)
 {
 	const Path &path = stem->getPath();
 	if (fork)
-		return path.getSize() - path.getDivisions() - 1;
+		return path.getSize() - getLastDivisions(path) - 1;
 	else
 		return path.getSize();
 }
@@ -366,8 +374,9 @@ void insertCurve(int sectionDivisions, int collarDivisions,
 	float dt = 1.0f / collarDivisions;
 	float t = 0.0f;
 	size_t index = 0;
+	BezierStepper stepper(curve, 2, t, dt);
 	for (int i = 0; i < collarDivisions; i++) {
-		v1[index].position = getLinearBezier(t, curve[0], curve[1]);
+		v1[index].position = stepper.next();
 		v1[index].normal = normalize(lerp(normal[0], normal[1], t));
 		v1[index].tangent = normalize(lerp(tangent[0], tangent[1], t));
 		v1[index].weights = lerp(weight[0], weight[1], t);
@@ -421,9 +430,9 @@ void insertCurve(int sectionDivisions, int collarDivisions, int size,
 	normal[1] = v2[sectionDivisions+size].normal;
 	tangent[1] = v2[sectionDivisions+size].tangent;
 
+	BezierStepper stepper(curve, 3, t, dt);
 	for (int j = 0; j < collarDivisions; j++) {
-		Vec3 p = getQuadraticBezier(t, curve[0], curve[1], curve[2]);
-		v1[index].position = p;
+		v1[index].position = stepper.next();
 		v1[index].normal = normalize(lerp(normal[0], normal[1], t));
 		v1[index].tangent = normalize(lerp(tangent[0], tangent[1], t));
 		v1[index].weights = lerp(weight[0], weight[1], s);
@@ -443,9 +452,9 @@ void insertCurve(int sectionDivisions, int collarDivisions, int size,
 	if (invert)
 		dt = -dt;
 
+	stepper = BezierStepper(curve, 3, t, dt);
 	for (int j = 0; j < collarDivisions; j++) {
-		Vec3 p = getQuadraticBezier(t, curve[0], curve[1], curve[2]);
-		v2[index].position = p;
+		v2[index].position = stepper.next();
 		v2[index].normal = normalize(lerp(normal[0], normal[1], t));
 		v2[index].tangent = normalize(lerp(tangent[0], tangent[1], t));
 		v2[index].weights = lerp(weight[0], weight[1], s);
@@ -461,7 +470,7 @@ void setFork1UVs(Stem *stem, int sDivisions, int cDivisions, DVertex *v)
 	const Vec3 location = stem->getLocation();
 	const Path &path = stem->getPath();
 	const Vec3 c[2] = {
-		location + path.get(path.getSize()-path.getDivisions()-2),
+		location + path.get(path.getSize()-getLastDivisions(path)-2),
 		location + path.get(path.getSize()-1)};
 	for (int i = 0, offset = 0; i < cDivisions; i++)
 		for (int j = 0; j < sDivisions; j++, offset++) {
@@ -976,18 +985,15 @@ inline size_t getTriangleOffset(const Segment &parent, const Segment &child)
 inline void insertCurve(Vec3 c[4], int degree, DVertex v, int cDivisions,
 	int sDivisions,  DVertex *buffer)
 {
+	/* The quadratic curve skips the second control point. */
+	Vec3 points[3] = {c[0], c[1], c[3]};
 	float delta = 1.0f / (cDivisions + 1);
-	float t = delta;
-	if (degree == 3)
-		for (int i = 0; i < cDivisions; i++, t += delta) {
-			v.position = getCubicBezier(t, c[0], c[1], c[2], c[3]);
-			buffer[sDivisions*i] = v;
-		}
-	else
-		for (int i = 0; i < cDivisions; i++, t += delta) {
-			v.position = getQuadraticBezier(t, c[0], c[1], c[3]);
-			buffer[sDivisions*i] = v;
-		}
+	const Vec3 *controls = degree == 3 ? c : points;
+	BezierStepper stepper(controls, degree + 1, delta, delta);
+	for (int i = 0; i < cDivisions; i++) {
+		v.position = stepper.next();
+		buffer[sDivisions*i] = v;
+	}
 }
 
 size_t Mesh::insertCollar(Segment child, Segment parent, size_t vertexStart)
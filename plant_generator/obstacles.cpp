@@ -0,0 +1,301 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "obstacles.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+using pg::Obstacles;
+using pg::Vec3;
+using pg::Volume;
+
+const char magic[4] = {'p', 'g', 'o', 'b'};
+const uint32_t version = 1;
+
+/* Set the obstacle density of every leaf below a node. Densities are never
+lowered so that overlapping obstacles are kept. */
+static void fill(Volume::Node *node, float density)
+{
+	if (node->getNode(0))
+		for (int i = 0; i < 8; i++)
+			fill(node->getNode(i), density);
+	else if (node->getObstacleDensity() < density)
+		node->setObstacleDensity(density);
+}
+
+Obstacles::Obstacles() : cellSize(1.0f), density(1.0f)
+{
+
+}
+
+void Obstacles::setGeometry(
+	const Geometry &geometry, float cellSize, float density)
+{
+	this->cellSize = cellSize;
+	this->density = density;
+	this->cells.clear();
+	const std::vector<DVertex> &points = geometry.getPoints();
+	const std::vector<unsigned> &indices = geometry.getIndices();
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		Vec3 a = points[indices[i]].position;
+		Vec3 b = points[indices[i+1]].position;
+		Vec3 c = points[indices[i+2]].position;
+		addTriangle(a, b, c);
+	}
+
+	auto less = [] (const Cell &a, const Cell &b) {
+		if (a.x != b.x)
+			return a.x < b.x;
+		if (a.y != b.y)
+			return a.y < b.y;
+		return a.z < b.z;
+	};
+	auto equal = [] (const Cell &a, const Cell &b) {
+		return a.x == b.x && a.y == b.y && a.z == b.z;
+	};
+	std::sort(this->cells.begin(), this->cells.end(), less);
+	auto last = std::unique(this->cells.begin(), this->cells.end(), equal);
+	this->cells.erase(last, this->cells.end());
+}
+
+/** The triangle is sampled at half the width of a cell so that no cell
+that the surface passes through is skipped. */
+void Obstacles::addTriangle(Vec3 a, Vec3 b, Vec3 c)
+{
+	float length = std::max(magnitude(b-a), magnitude(c-a));
+	length = std::max(length, magnitude(c-b));
+	int steps = std::ceil(2.0f * length / this->cellSize);
+	steps = std::max(steps, 1);
+	for (int i = 0; i <= steps; i++) {
+		for (int j = 0; i + j <= steps; j++) {
+			float u = static_cast<float>(i) / steps;
+			float v = static_cast<float>(j) / steps;
+			this->cells.push_back(getCell(a + u*(b-a) + v*(c-a)));
+		}
+	}
+}
+
+void Obstacles::merge(Volume *volume) const
+{
+	std::vector<Patch> patches;
+	getPatches(volume, patches);
+	merge(volume, patches);
+}
+
+/** Cells are sorted by the index of the node that contains them so that
+every node is only visited once. */
+void Obstacles::getPatches(
+	const Volume *volume, std::vector<Patch> &patches) const
+{
+	struct Key {
+		int32_t x;
+		int32_t y;
+		int32_t z;
+		Vec3 point;
+	};
+
+	const Volume::Node *root = volume->getRoot();
+	Vec3 center = root->getCenter();
+	float size = root->getSize();
+	int depth = getDepth(volume);
+	int32_t count = 1 << depth;
+	float width = std::ldexp(2.0f * size, -depth);
+	Vec3 corner = center - Vec3(size, size, size);
+	auto index = [&] (float x) {
+		int32_t i = std::floor(x / width);
+		return std::min(i, count - 1);
+	};
+
+	std::vector<Key> keys;
+	keys.reserve(this->cells.size());
+	for (Cell cell : this->cells) {
+		Vec3 point = getCenter(cell);
+		Vec3 d = point - center;
+		float m = std::max(std::abs(d.x), std::abs(d.y));
+		if (std::max(m, std::abs(d.z)) > size)
+			continue;
+		Vec3 p = point - corner;
+		keys.push_back({index(p.x), index(p.y), index(p.z), point});
+	}
+
+	auto less = [] (const Key &a, const Key &b) {
+		if (a.x != b.x)
+			return a.x < b.x;
+		if (a.y != b.y)
+			return a.y < b.y;
+		return a.z < b.z;
+	};
+	std::sort(keys.begin(), keys.end(), less);
+	patches.clear();
+	for (size_t i = 0; i < keys.size(); i++) {
+		const Key &key = keys[i];
+		if (i > 0 && !less(keys[i-1], key))
+			patches.back().cells++;
+		else
+			patches.push_back({key.point, 1});
+	}
+}
+
+/** A cell that is smaller than a node only blocks part of the light that
+passes through the node. The cells are surfaces, so the light that is
+blocked is proportional to the square of the width of a cell. */
+void Obstacles::merge(Volume *volume, const std::vector<Patch> &patches) const
+{
+	int depth = getDepth(volume);
+	for (const Patch &patch : patches) {
+		Volume::Node *node = volume->addNode(patch.point, depth);
+		while (node->getDepth() > depth)
+			node = node->getParent();
+		float w = 0.5f * this->cellSize / node->getSize();
+		float coverage = patch.cells * std::min(w*w, 1.0f);
+		fill(node, std::min(coverage, 1.0f) * this->density);
+	}
+}
+
+bool Obstacles::save(const char *filename) const
+{
+	std::ofstream file(filename, std::ios::binary);
+	uint64_t size = this->cells.size();
+	file.write(magic, sizeof(magic));
+	file.write(reinterpret_cast<const char *>(&version), sizeof(version));
+	file.write(reinterpret_cast<const char *>(&this->cellSize),
+		sizeof(this->cellSize));
+	file.write(reinterpret_cast<const char *>(&this->density),
+		sizeof(this->density));
+	file.write(reinterpret_cast<const char *>(&size), sizeof(size));
+	file.write(reinterpret_cast<const char *>(this->cells.data()),
+		size * sizeof(Cell));
+	return file.good();
+}
+
+bool Obstacles::load(const char *filename)
+{
+	std::ifstream file(filename, std::ios::binary);
+	char m[4];
+	uint32_t v;
+	float cellSize;
+	float density;
+	uint64_t size;
+	file.read(m, sizeof(m));
+	file.read(reinterpret_cast<char *>(&v), sizeof(v));
+	if (!file || !std::equal(m, m + 4, magic) || v != version)
+		return false;
+	file.read(reinterpret_cast<char *>(&cellSize), sizeof(cellSize));
+	file.read(reinterpret_cast<char *>(&density), sizeof(density));
+	file.read(reinterpret_cast<char *>(&size), sizeof(size));
+	if (!file)
+		return false;
+
+	std::vector<Cell> cells(size);
+	file.read(reinterpret_cast<char *>(cells.data()), size * sizeof(Cell));
+	if (!file)
+		return false;
+	this->cellSize = cellSize;
+	this->density = density;
+	this->cells.swap(cells);
+	return true;
+}
+
+void Obstacles::clear()
+{
+	this->cells.clear();
+}
+
+size_t Obstacles::getCellCount() const
+{
+	return this->cells.size();
+}
+
+float Obstacles::getCellSize() const
+{
+	return this->cellSize;
+}
+
+float Obstacles::getDensity() const
+{
+	return this->density;
+}
+
+bool Obstacles::operator==(const Obstacles &obstacles) const
+{
+	auto equal = [] (const Cell &a, const Cell &b) {
+		return a.x == b.x && a.y == b.y && a.z == b.z;
+	};
+	return this->cellSize == obstacles.cellSize &&
+		this->density == obstacles.density &&
+		this->cells.size() == obstacles.cells.size() &&
+		std::equal(this->cells.begin(), this->cells.end(),
+			obstacles.cells.begin(), equal);
+}
+
+Vec3 Obstacles::getMin() const
+{
+	Vec3 min(0.0f, 0.0f, 0.0f);
+	for (size_t i = 0; i < this->cells.size(); i++) {
+		const Cell &cell = this->cells[i];
+		Vec3 point(cell.x, cell.y, cell.z);
+		point = this->cellSize * point;
+		if (i == 0)
+			min = point;
+		min.x = std::min(min.x, point.x);
+		min.y = std::min(min.y, point.y);
+		min.z = std::min(min.z, point.z);
+	}
+	return min;
+}
+
+Vec3 Obstacles::getMax() const
+{
+	Vec3 max(0.0f, 0.0f, 0.0f);
+	for (size_t i = 0; i < this->cells.size(); i++) {
+		const Cell &cell = this->cells[i];
+		Vec3 point(cell.x + 1, cell.y + 1, cell.z + 1);
+		point = this->cellSize * point;
+		if (i == 0)
+			max = point;
+		max.x = std::max(max.x, point.x);
+		max.y = std::max(max.y, point.y);
+		max.z = std::max(max.z, point.z);
+	}
+	return max;
+}
+
+/** The depth at which nodes are about as wide as a cell. */
+int Obstacles::getDepth(const Volume *volume) const
+{
+	float size = volume->getRoot()->getSize();
+	int depth = std::round(std::log2(2.0f * size / this->cellSize));
+	depth = std::max(depth, 0);
+	return std::min(depth, volume->getDepth());
+}
+
+Obstacles::Cell Obstacles::getCell(Vec3 point) const
+{
+	Cell cell;
+	cell.x = std::floor(point.x / this->cellSize);
+	cell.y = std::floor(point.y / this->cellSize);
+	cell.z = std::floor(point.z / this->cellSize);
+	return cell;
+}
+
+Vec3 Obstacles::getCenter(Cell cell) const
+{
+	Vec3 center;
+	center.x = (cell.x + 0.5f) * this->cellSize;
+	center.y = (cell.y + 0.5f) * this->cellSize;
+	center.z = (cell.z + 0.5f) * this->cellSize;
+	return center;
+}
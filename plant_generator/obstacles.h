@@ -0,0 +1,88 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PG_OBSTACLES_H
+#define PG_OBSTACLES_H
+
+#include "geometry.h"
+#include "volume.h"
+#include "math/vec3.h"
+#include <cstdint>
+#include <vector>
+
+namespace pg {
+	/** Static geometry such as walls and rocks that blocks light. The
+	triangles are voxelized once into cells of a fixed size, and the cells
+	are merged into every volume that a plant is grown in. */
+	class Obstacles {
+	public:
+		/** Cells that are merged into the same node of a volume. */
+		struct Patch {
+			Vec3 point;
+			int cells;
+		};
+
+		Obstacles();
+		/** Voxelize the surface of a mesh into cells of a width. */
+		void setGeometry(
+			const Geometry &geometry, float cellSize,
+			float density = 1.0f);
+		/** Add the density of the cells to the leaf nodes of a volume.
+		Nodes are divided until they are about as wide as a cell. */
+		void merge(Volume *volume) const;
+		/** Group the cells by the nodes that they are merged into.
+		Cells outside of the volume are skipped. The patches can be
+		reused for any volume of the same size and depth. */
+		void getPatches(
+			const Volume *volume,
+			std::vector<Patch> &patches) const;
+		/** Merge patches that were created for the volume. */
+		void merge(
+			Volume *volume,
+			const std::vector<Patch> &patches) const;
+		/** Save the cells to a binary file. Returns false if the file
+		could not be written. */
+		bool save(const char *filename) const;
+		/** Load cells that were saved with save. Returns false if the
+		file could not be read. */
+		bool load(const char *filename);
+		void clear();
+		size_t getCellCount() const;
+		float getCellSize() const;
+		float getDensity() const;
+		/** The corners of the bounding box of the cells. */
+		Vec3 getMin() const;
+		Vec3 getMax() const;
+		bool operator==(const Obstacles &obstacles) const;
+
+	private:
+		struct Cell {
+			int32_t x;
+			int32_t y;
+			int32_t z;
+		};
+
+		float cellSize;
+		float density;
+		std::vector<Cell> cells;
+
+		void addTriangle(Vec3, Vec3, Vec3);
+		Cell getCell(Vec3) const;
+		Vec3 getCenter(Cell) const;
+		int getDepth(const Volume *) const;
+	};
+}
+
+#endif
@@ -30,6 +30,17 @@ namespace pg {
 		int node;
 
 		GeneratorState();
+
+	private:
+#ifdef PG_SERIALIZE
+		friend class boost::serialization::access;
+		template<class Archive>
+		void serialize(Archive &ar, const unsigned)
+		{
+			ar & concentration;
+			ar & node;
+		}
+#endif
 	};
 
 	struct LeafData {
@@ -14,13 +14,19 @@
  */
 
 #include "path.h"
+#include <algorithm>
+#include <cmath>
 #include <limits>
 
 using pg::Path;
 using pg::Spline;
 using pg::Vec3;
 
-Path::Path() : divisions(0), initialDivisions(0), subdivisions(0), length(0.0f)
+Path::Path() :
+	divisions(0),
+	initialDivisions(0),
+	tolerance(0.0f),
+	length(0.0f)
 {
 
 }
@@ -32,7 +38,7 @@ bool Path::operator==(const Path &path) const
 		this->spline == path.spline &&
 		this->divisions == path.divisions &&
 		this->initialDivisions == path.initialDivisions &&
-		this->subdivisions == path.subdivisions);
+		this->tolerance == path.tolerance);
 }
 
 bool Path::operator!=(const Path &path) const
@@ -44,36 +50,77 @@ void Path::generate()
 {
 	size_t size = this->spline.getControls().size();
 	int curves = this->spline.getCurveCount();
-	if (size <= 1)
+	if (size <= 1 || curves == 0)
 		return;
 
-	this->path.clear();
-
-	float delta = 1.0f / (this->initialDivisions+1);
-	for (int i = 0; i <= this->initialDivisions; i++) {
-		float t = delta * i;
-		Vec3 point = this->spline.getPoint(0, t);
-		this->path.push_back(point);
+	/* Each curve fills its span of the path at once. */
+	std::vector<int> points(curves);
+	size_t total = 0;
+	for (int curve = 0; curve < curves; curve++) {
+		points[curve] = getCurveDivisions(curve) + 1;
+		total += points[curve];
 	}
-
-	delta = 1.0f / (this->divisions+1);
-	for (int curve = 1; curve < curves; curve++) {
-		for (int i = 0; i <= this->divisions; i++) {
-			float t = delta * i;
-			Vec3 point = this->spline.getPoint(curve, t);
-			this->path.push_back(point);
-		}
+	this->path.resize(total);
+	Vec3 *span = &this->path[0];
+	for (int curve = 0; curve < curves; curve++) {
+		float delta = 1.0f / points[curve];
+		int count = points[curve];
+		this->spline.getPoints(curve, 0.0f, delta, count, span);
+		span += count;
 	}
 
 	this->path.push_back(this->spline.getControls()[size-1]);
 	setLength();
 }
 
+void Path::addControl(Vec3 control)
+{
+	int curve = this->spline.getCurveCount();
+	this->spline.addControl(control);
+	if (this->spline.getDegree() != 1 || curve == 0 || this->path.empty()) {
+		generate();
+		return;
+	}
+
+	/* The last point of the path is the start of the new curve and is
+	evaluated again so that the points match the generated path. */
+	size_t size = this->path.size();
+	int points = getCurveDivisions(curve) + 1;
+	this->path.resize(size - 1 + points);
+	float delta = 1.0f / points;
+	Vec3 *span = &this->path[size - 1];
+	this->spline.getPoints(curve, 0.0f, delta, points, span);
+	this->path.push_back(control);
+	for (size_t i = size; i < this->path.size(); i++) {
+		this->length += magnitude(this->path[i] - this->path[i - 1]);
+		this->distances.push_back(this->length);
+	}
+}
+
+/** The distances are summed once so that distances along the path can be
+looked up instead of being summed again for each query. */
 void Path::setLength()
 {
 	this->length = 0.0f;
-	for (size_t i = 0; i < this->path.size() - 1; i++)
-		this->length += magnitude(this->path[i + 1] - this->path[i]);
+	this->distances.clear();
+	this->distances.reserve(this->path.size());
+	if (!this->path.empty())
+		this->distances.push_back(0.0f);
+	for (size_t i = 1; i < this->path.size(); i++) {
+		this->length += magnitude(this->path[i] - this->path[i - 1]);
+		this->distances.push_back(this->length);
+	}
+}
+
+/** Return the index of the first segment that ends at or after a distance
+or the number of segments if the path is shorter. */
+size_t Path::getSegment(float distance) const
+{
+	if (this->distances.size() < 2)
+		return 0;
+	auto begin = this->distances.begin() + 1;
+	auto it = std::lower_bound(begin, this->distances.end(), distance);
+	return it - begin;
 }
 
 void Path::setSpline(const Spline &spline)
@@ -81,7 +128,7 @@ void Path::setSpline(const Spline &spline)
 	this->spline = spline;
 }
 
-Spline Path::getSpline() const
+const Spline &Path::getSpline() const
 {
 	return this->spline;
 }
@@ -106,15 +153,38 @@ int Path::getInitialDivisions() const
 	return this->initialDivisions;
 }
 
-void Path::subdivide(int level)
+void Path::subdivide(float tolerance)
+{
+	this->tolerance = tolerance;
+}
+
+float Path::getTolerance() const
 {
-	this->subdivisions = level;
-	/* TODO subdivide */
+	return this->tolerance;
 }
 
-int Path::getSubdivisions() const
+/** The first curve is always sampled with the initial divisions because
+collars are built from its points. The distance between a curve and its
+chords is at most an eighth of the largest second derivative divided by the
+square of the number of chords. */
+int Path::getCurveDivisions(int curve) const
 {
-	return this->subdivisions;
+	if (curve <= 0)
+		return this->initialDivisions;
+	if (this->tolerance <= 0.0f || this->divisions == 0)
+		return this->divisions;
+
+	const int degree = this->spline.getDegree();
+	const Vec3 *p = &this->spline.getControls()[degree * curve];
+	float derivative = 0.0f;
+	for (int i = 0; i + 2 <= degree; i++) {
+		Vec3 difference = p[i] - 2.0f * p[i+1] + p[i+2];
+		derivative = std::max(derivative, magnitude(difference));
+	}
+	derivative *= degree * (degree - 1);
+	float chords = std::sqrt(derivative / (8.0f * this->tolerance));
+	chords = std::min(std::ceil(chords), this->divisions + 1.0f);
+	return std::max(static_cast<int>(chords) - 1, 0);
 }
 
 std::vector<Vec3> Path::get() const
@@ -134,39 +204,17 @@ size_t Path::getSize() const
 
 Vec3 Path::getIntermediate(float distance) const
 {
-	float total = 0.0f;
-	Vec3 point(
-		std::numeric_limits<float>::quiet_NaN(),
-		std::numeric_limits<float>::quiet_NaN(),
-		std::numeric_limits<float>::quiet_NaN());
-
-	for (size_t i = 0; i < this->path.size() - 1; i++) {
-		float length = magnitude(this->path[i + 1] - this->path[i]);
-		if (total + length >= distance) {
-			point = (distance - total) * getDirection(i);
-			point += this->path[i];
-			total += length;
-			break;
-		}
-		total += length;
-	}
-
-	if (total < distance)
-		point = this->path.back();
-
-	return point;
+	size_t index = getSegment(distance);
+	if (index + 1 >= this->path.size())
+		return this->path.back();
+	Vec3 point = (distance - this->distances[index]) * getDirection(index);
+	return point + this->path[index];
 }
 
 size_t Path::getIndex(float distance) const
 {
-	float total = 0.0f;
-	for (size_t i = 0; i < this->path.size(); i++) {
-		float length = magnitude(this->path[i + 1] - this->path[i]);
-		if (total + length >= distance)
-			return i;
-		total += length;
-	}
-	return this->path.size();
+	size_t index = getSegment(distance);
+	return index + 1 < this->path.size() ? index : this->path.size();
 }
 
 float Path::getLength() const
@@ -196,30 +244,20 @@ Vec3 Path::getAverageDirection(size_t index) const
 
 Vec3 Path::getIntermediateDirection(float t) const
 {
-	Vec3 direction;
-	float s = 0.0f;
-	for (size_t i = 0; i < this->path.size() - 1; i++) {
-		s += magnitude(this->path[i+1] - this->path[i]);
-		if (s >= t)
-			return getDirection(i);
-	}
-	return getDirection(this->path.size() - 1);
+	size_t index = getSegment(t);
+	if (index + 1 >= this->path.size())
+		index = this->path.size() - 1;
+	return getDirection(index);
 }
 
 float Path::getDistance(size_t index) const
 {
-	float distance = 0.0f;
-	for (size_t i = 0; i < index; i++)
-		distance += magnitude(this->path[i + 1] - this->path[i]);
-	return distance;
+	return this->distances[index];
 }
 
 float Path::getDistance(size_t start, size_t end) const
 {
-	float distance = 0.0f;
-	for (size_t i = start; i < end; i++)
-		distance += magnitude(this->path[i + 1] - this->path[i]);
-	return distance;
+	return this->distances[end] - this->distances[start];
 }
 
 float Path::getSegmentLength(size_t index) const
@@ -235,13 +273,15 @@ size_t Path::toPathIndex(size_t control) const
 	size_t i = control / this->spline.getDegree();
 	if (i == 0)
 		return 0;
-	return (i-1) * (1+this->divisions) + (1+this->initialDivisions);
+	if (this->tolerance <= 0.0f)
+		return (i-1) * (1+this->divisions) + (1+this->initialDivisions);
+	size_t index = 0;
+	for (size_t curve = 0; curve < i; curve++)
+		index += getCurveDivisions(curve) + 1;
+	return index;
 }
 
 float Path::getPercentage(size_t index) const
 {
-	float length = 0.0f;
-	for (size_t i = 0; i < index; i++)
-		length += magnitude(this->path[i+1] - this->path[i]);
-	return length / this->length;
+	return this->distances[index] / this->length;
 }
@@ -24,13 +24,16 @@ namespace pg {
 	class Path {
 	protected:
 		std::vector<Vec3> path;
+		/* The distance along the path to each point. */
+		std::vector<float> distances;
 		Spline spline;
 		int divisions;
 		int initialDivisions;
-		int subdivisions;
+		float tolerance;
 		float length;
 
 		void setLength();
+		size_t getSegment(float distance) const;
 
 #ifdef PG_SERIALIZE
 		friend class boost::serialization::access;
@@ -41,7 +44,7 @@ namespace pg {
 			ar & spline;
 			ar & divisions;
 			ar & initialDivisions;
-			ar & subdivisions;
+			ar & tolerance;
 			setLength();
 		}
 #endif
@@ -53,16 +56,24 @@ namespace pg {
 		Path();
 
 		void setSpline(const Spline &spline);
-		Spline getSpline() const;
+		const Spline &getSpline() const;
 		/** Set the divisions for each curve in the path. */
 		void setDivisions(int divisions);
 		int getDivisions() const;
 		void setInitialDivisions(int divisions);
 		int getInitialDivisions() const;
-		void subdivide(int level);
-		int getSubdivisions() const;
+		/** Sample each curve after the first with as few of its
+		divisions as are needed to keep the path within a distance of
+		the curve. A tolerance of zero samples curves uniformly. */
+		void subdivide(float tolerance);
+		float getTolerance() const;
+		/** Return the number of points between the ends of a curve. */
+		int getCurveDivisions(int curve) const;
 		/** Evaluate points along the spline. */
 		void generate();
+		/** Add a control to the end of the spline. Only the points of
+		the new curve are evaluated if the spline is linear. */
+		void addControl(Vec3 control);
 
 		std::vector<Vec3> get() const;
 		/** Return a point on the path. */
@@ -15,14 +15,42 @@
 
 #include "plant.h"
 #include "pattern_generator.h"
+#include <atomic>
 #include <cstdlib>
 #include <cmath>
+#include <thread>
 
 using namespace pg;
 
 const float pi = 3.14159265359f;
 
-PatternGenerator::PatternGenerator(Plant *plant) : plant(plant)
+/* Combine a key with a value using the finalizer of SplitMix64. */
+static uint64_t mix(uint64_t key, uint64_t value)
+{
+	uint64_t x = key + 0x9e3779b97f4a7c15ull * (value + 1);
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+	return x ^ (x >> 31);
+}
+
+PatternGenerator::Random::Random(uint64_t key) : key(key), counter(0)
+{
+
+}
+
+/** Return an independent stream for a child of the stem. */
+PatternGenerator::Random PatternGenerator::Random::getStream(
+	uint64_t index) const
+{
+	return Random(mix(this->key, index));
+}
+
+PatternGenerator::Random::result_type PatternGenerator::Random::operator()()
+{
+	return static_cast<result_type>(mix(this->key, this->counter++) >> 32);
+}
+
+PatternGenerator::PatternGenerator(Plant *plant) : plant(plant), threads(0)
 {
 
 }
@@ -35,14 +63,41 @@ ParameterTree PatternGenerator::getParameterTree() const
 void PatternGenerator::setParameterTree(ParameterTree parameterTree)
 {
 	this->parameterTree = parameterTree;
+	this->records.clear();
 }
 
-void PatternGenerator::reset()
+/** The data of the nodes is copied if the tree has the same structure so
+that the records still refer to the nodes. Returns false if the tree was
+replaced instead. */
+bool PatternGenerator::updateParameterTree(const ParameterTree &tree)
 {
 	ParameterNode *root = this->parameterTree.getRoot();
-	if (root) {
-		this->mt.seed(root->getData().seed);
-		this->mt.discard(100);
+	std::vector<std::string> names = tree.getNames();
+	bool same = names == this->parameterTree.getNames();
+	if (!root || !tree.getRoot() || !same) {
+		setParameterTree(tree);
+		return false;
+	}
+	root->setData(tree.getRoot()->getData());
+	for (const std::string &name : names) {
+		ParameterNode *node = this->parameterTree.get(name);
+		node->setData(tree.get(name)->getData());
+	}
+	return true;
+}
+
+/** The curves of the nodes are converted to tables before the stems are
+generated, since they are evaluated for every lateral and leaf. */
+void PatternGenerator::setCurves(const ParameterNode *node)
+{
+	while (node) {
+		StemData data = node->getData();
+		Curves &curves = this->curves[node];
+		curves.density = CurveTable(data.densityCurve);
+		curves.incline = CurveTable(data.inclineCurve);
+		curves.leafDensity = CurveTable(data.leaf.densityCurve);
+		setCurves(node->getChild());
+		node = node->getSibling();
 	}
 }
 
@@ -54,32 +109,169 @@ void PatternGenerator::grow()
 	stem->setMaxRadius(0.2f);
 	stem->setMinRadius(0.01f);
 	stem->setSwelling(Vec2(1.3f, 1.3f));
+	this->records.clear();
 	const ParameterNode *root = this->parameterTree.getRoot();
-	if (root) {
-		reset();
-		Vec3 d(0.0f, 0.0f, 1.0f);
-		float l = getCollarLength(stem, d);
-		float pathRatio = setPath(stem, d, l, root->getData());
-		addStems(stem, pathRatio, 0.0f, root);
-	}
+	if (root)
+		grow(stem, Vec3(0.0f, 0.0f, 1.0f), root);
 }
 
 void PatternGenerator::grow(Stem *stem)
 {
-	this->parameterTree = stem->getParameterTree();
+	updateParameterTree(stem->getParameterTree());
 	ParameterNode *root = this->parameterTree.getRoot();
 	if (root) {
-		reset();
 		const Path &path = stem->getPath();
-		Vec3 d = path.getDirection(0);
-		float l = getCollarLength(stem, d);
-		float pathRatio = setPath(stem, d, l, root->getData());
-		addStems(stem, pathRatio, 0.0f, root);
+		grow(stem, path.getDirection(0), root);
+	}
+}
+
+/** The laterals and leaves that the children of the parent node added are
+removed and added again. The random numbers of a stem do not depend on the
+other stems, so the plant is the same as if it was generated again. */
+bool PatternGenerator::grow(Stem *stem, std::string name)
+{
+	if (!updateParameterTree(stem->getParameterTree()))
+		return false;
+	const ParameterNode *node = this->parameterTree.get(name);
+	if (!node || this->records.find(stem) == this->records.end())
+		return false;
+	node = node->getParent();
+	if (!node)
+		node = this->parameterTree.getRoot();
+	this->curves.clear();
+	setCurves(this->parameterTree.getRoot());
+
+	std::vector<Stem *> stems;
+	getStems(stem, node, stems);
+	for (Stem *stem : stems)
+		removeLaterals(stem, node);
+	forEach(stems.size(), [&] (Task &task, int index) {
+		Stem *stem = stems[index];
+		addNodes(stem, this->records.at(stem), task);
+	});
+	return true;
+}
+
+void PatternGenerator::forget(Stem *stem)
+{
+	removeRecords(stem);
+}
+
+/** The laterals of the first stem and of its forks are collected first.
+Their subtrees only add stems to themselves, so they are then generated on
+separate threads. */
+void PatternGenerator::grow(
+	Stem *stem, Vec3 direction, const ParameterNode *root)
+{
+	StemData data = root->getData();
+	Random random(mix(data.seed, 0));
+	Task task = {true, {}, {}};
+	this->curves.clear();
+	setCurves(root);
+	float l = getCollarLength(stem, direction);
+	float pathRatio = setPath(stem, direction, l, data, random);
+	addStems(stem, pathRatio, 0.0f, root, random, task);
+	addRecords(task);
+
+	std::vector<Lateral> &laterals = task.laterals;
+	forEach(laterals.size(), [&] (Task &task, int index) {
+		Lateral &lateral = laterals[index];
+		StemData data = lateral.node->getData();
+		float pathRatio = setPath(lateral.stem, lateral.direction,
+			lateral.collarLength, data, lateral.random);
+		addStems(lateral.stem, pathRatio, 0.0f, lateral.node,
+			lateral.random, task);
+	});
+}
+
+/** Call a function for each index on separate threads. The records of
+each thread are added once all threads are done. */
+void PatternGenerator::forEach(
+	int size, const std::function<void(Task &, int)> &function)
+{
+	int threads = this->threads;
+	if (threads <= 0)
+		threads = std::thread::hardware_concurrency();
+	if (threads > size)
+		threads = size;
+	if (threads < 1)
+		return;
+
+	std::vector<Task> tasks(threads, Task{false, {}, {}});
+	std::atomic<int> next(0);
+	auto run = [&] (Task &task) {
+		int index;
+		while ((index = next++) < size)
+			function(task, index);
+	};
+	std::vector<std::thread> workers;
+	for (int i = 1; i < threads; i++)
+		workers.emplace_back(run, std::ref(tasks[i]));
+	run(tasks[0]);
+	for (std::thread &worker : workers)
+		worker.join();
+	for (const Task &task : tasks)
+		addRecords(task);
+}
+
+void PatternGenerator::addRecords(const Task &task)
+{
+	for (const auto &record : task.records) {
+		auto result = this->records.insert(record);
+		if (!result.second)
+			result.first->second = record.second;
+	}
+}
+
+void PatternGenerator::removeRecords(const Stem *stem)
+{
+	this->records.erase(stem);
+	const Stem *child = stem->getChild();
+	while (child) {
+		removeRecords(child);
+		child = child->getSibling();
 	}
 }
 
+/** Find the stems that the child nodes of a node add laterals to. */
+void PatternGenerator::getStems(
+	Stem *stem, const ParameterNode *node, std::vector<Stem *> &stems)
+{
+	auto it = this->records.find(stem);
+	if (it == this->records.end())
+		return;
+	if (it->second.node == node)
+		stems.push_back(stem);
+	for (Stem *child = stem->getChild(); child; child = child->getSibling())
+		getStems(child, node, stems);
+}
+
+/** Remove the generated laterals and leaves of a stem. Forks are recorded
+with the same node as the stem and are kept. */
+void PatternGenerator::removeLaterals(Stem *stem, const ParameterNode *node)
+{
+	for (int i = stem->getLeafCount() - 1; i >= 0; i--)
+		if (!stem->getLeaf(i)->isCustom())
+			stem->removeLeaf(i);
+
+	Stem *child = stem->getChild();
+	while (child) {
+		Stem *sibling = child->getSibling();
+		auto it = this->records.find(child);
+		bool fork = it != this->records.end();
+		fork = fork && it->second.node == node;
+		if (!child->isCustom() && !fork) {
+			removeRecords(child);
+			this->plant->deleteStem(child);
+		}
+		child = sibling;
+	}
+}
+
+/** Laterals are added to the task instead of being generated if the task
+defers them. */
 float PatternGenerator::addStems(Stem *stem, float pathRatio, float length,
-	const ParameterNode *node)
+	const ParameterNode *node, Random &random, Task &task)
 {
 	const StemData &data = node->getData();
 	float totalLength = length + stem->getPath().getLength();
@@ -88,8 +280,8 @@ float PatternGenerator::addStems(Stem *stem, float pathRatio, float length,
 		stem->setMinRadius(0.0f);
 	else {
 		float radius = stem->getMinRadius() * 0.8f;
-		Vec3 direction1 = getForkDirection(stem, 1.0f, data);
-		Vec3 direction2 = getForkDirection(stem, -1.0f, data);
+		Vec3 direction1 = getForkDirection(stem, 1.0f, data, random);
+		Vec3 direction2 = getForkDirection(stem, -1.0f, data, random);
 		float t = 0.5f * std::acos(dot(direction1, direction2));
 		float l = radius * std::sin(0.5f*pi-t) / std::sin(t) * 1.1f;
 
@@ -97,28 +289,39 @@ float PatternGenerator::addStems(Stem *stem, float pathRatio, float length,
 		fork1->setMaxRadius(radius);
 		fork1->setDistance(std::numeric_limits<float>::max());
 		fork1->setSectionDivisions(stem->getSectionDivisions());
-		pathRatio = setPath(fork1, direction1, l, node->getData());
-		totalLength = addStems(fork1, pathRatio, totalLength, node);
+		Random random1 = random.getStream(0);
+		pathRatio = setPath(fork1, direction1, l, data, random1);
+		totalLength = addStems(
+			fork1, pathRatio, totalLength, node, random1, task);
 		Stem *fork2 = plant->addStem(stem);
 		fork2->setMaxRadius(radius);
 		fork2->setDistance(std::numeric_limits<float>::max());
 		fork2->setSectionDivisions(stem->getSectionDivisions());
-		pathRatio = setPath(fork2, direction2, l, node->getData());
-		addStems(fork2, pathRatio, totalLength, node);
+		Random random2 = random.getStream(1);
+		pathRatio = setPath(fork2, direction2, l, data, random2);
+		addStems(fork2, pathRatio, totalLength, node, random2, task);
 	}
 
-	node = node->getChild();
-	while (node) {
-		Length l(length, totalLength);
-		addLateralStems(stem, l, node);
-		addLeaves(stem, l, node->getData().leaf);
+	Record record = {node, Length(length, totalLength), random};
+	task.records.emplace_back(stem, record);
+	addNodes(stem, record, task);
+	return totalLength;
+}
+
+void PatternGenerator::addNodes(Stem *stem, const Record &record, Task &task)
+{
+	const ParameterNode *node = record.node->getChild();
+	for (uint64_t i = 2; node; i++) {
+		Random random = record.random.getStream(i);
+		addLateralStems(stem, record.length, node, random, task);
+		addLeaves(stem, record.length, node->getData().leaf,
+			this->curves.at(node).leafDensity);
 		node = node->getSibling();
 	}
-	return totalLength;
 }
 
 void PatternGenerator::addLateralStems(Stem *parent, Length length,
-	const ParameterNode *node)
+	const ParameterNode *node, Random &random, Task &task)
 {
 	StemData stemData = node->getData();
 	if (stemData.density == 0.0f)
@@ -136,25 +339,28 @@ void PatternGenerator::addLateralStems(Stem *parent, Length length,
 	if (d2 != Vec3(0.0f, 0.0f, 1.0f))
 		d1 = cross(Vec3(0.0f, 0.0f, 1.0f), d2);
 
+	const CurveTable &density = this->curves.at(node).density;
 	for (int i = 0; position > end; i++) {
 		float t = position / length.total;
-		float r = stemData.densityCurve.getPoint(t).y;
+		float r = density.getValue(t);
 		if (r == 0.0f)
 			break;
-		addLateralStem(parent, position, length, i, d1, d2, node);
+		Random lateralRandom = random.getStream(i);
+		addLateralStem(parent, position, length, i, d1, d2, node,
+			lateralRandom, task);
 		position -= distance * (1.0f/r);
 	}
 }
 
 void PatternGenerator::addLateralStem(Stem *parent, float position,
 	Length length, int index, Vec3 &direction1, Vec3 &direction2,
-	const ParameterNode *node)
+	const ParameterNode *node, Random &random, Task &task)
 {
 	StemData data = node->getData();
 	Vec2 collar(1.5f, 3.0f);
 
 	float radius = this->plant->getIntermediateRadius(parent, position);
-	radius = modifyRadius(data, radius / collar.x);
+	radius = modifyRadius(data, radius / collar.x, random);
 	if (radius < data.radiusThreshold)
 		return;
 
@@ -174,36 +380,44 @@ void PatternGenerator::addLateralStem(Stem *parent, float position,
 	direction2 = d;
 	direction1 = rotate(r, direction1);
 
-	d = getDirection(stem, index, length, direction1, direction2, data);
+	const CurveTable &incline = this->curves.at(node).incline;
+	d = getDirection(stem, index, length, direction1, direction2, data,
+		incline, random);
 	float l = getCollarLength(stem, d);
-	float pathRatio = setPath(stem, d, l, node->getData());
-	addStems(stem, pathRatio, 0.0f, node);
+	if (task.defer)
+		task.laterals.push_back({stem, d, l, node, random});
+	else {
+		float pathRatio = setPath(stem, d, l, data, random);
+		addStems(stem, pathRatio, 0.0f, node, random, task);
+	}
 }
 
-float PatternGenerator::modifyRadius(const StemData &data, float radius)
+float PatternGenerator::modifyRadius(
+	const StemData &data, float radius, Random &random)
 {
 	std::normal_distribution<float> dis(1.0f, data.radiusVariation);
-	float variation = dis(this->mt);
+	float variation = dis(random);
 	if (variation > 1.0f)
 		variation = 1.0f;
 	return radius * data.radius * variation;
 }
 
 Vec3 PatternGenerator::getDirection(Stem *stem, int index, Length length,
-	Vec3 direction1, Vec3 direction2, const StemData &data)
+	Vec3 direction1, Vec3 direction2, const StemData &data,
+	const CurveTable &incline, Random &random)
 {
 	float variation = data.angleVariation * pi;
 	std::uniform_real_distribution<float> dis1(-variation, variation);
 	float ratio = (stem->getDistance() + length.current) / length.total;
-	float radialAngle = data.leaf.rotation*index + dis1(this->mt);
+	float radialAngle = data.leaf.rotation*index + dis1(random);
 	Quat radialRotation = fromAxisAngle(direction2, radialAngle);
 	direction1 = normalize(direction1);
 	direction1 = rotate(radialRotation, direction1);
 
-	ratio = data.inclineCurve.getPoint(ratio).y;
+	ratio = incline.getValue(ratio);
 	float t = 2.0f * (ratio - 0.5f);
 	std::normal_distribution<float> dis2(0.0f, data.inclineVariation);
-	t += dis2(this->mt);
+	t += dis2(random);
 	if (t < 0.0f) {
 		t *= -1.0f;
 		direction2 *= -1.0f;
@@ -215,7 +429,7 @@ Vec3 PatternGenerator::getDirection(Stem *stem, int index, Length length,
 }
 
 Vec3 PatternGenerator::getForkDirection(Stem *stem, float sign,
-	const StemData &data)
+	const StemData &data, Random &random)
 {
 	float minAngle = 0.1f;
 	float maxAngle = data.forkAngle;
@@ -230,7 +444,7 @@ Vec3 PatternGenerator::getForkDirection(Stem *stem, float sign,
 	if (parentDirection != up)
 		normal = normalize(cross(parentDirection, up));
 	normal = normalize(cross(normal, parentDirection));
-	float angle = sign * dis(this->mt);
+	float angle = sign * dis(random);
 
 	return rotateAroundAxis(parentDirection, normal, angle);
 }
@@ -251,7 +465,7 @@ float PatternGenerator::getCollarLength(Stem *stem, Vec3 direction)
 }
 
 float PatternGenerator::setPath(Stem *stem, Vec3 direction, float collarLength,
-	const StemData &data)
+	const StemData &data, Random &random)
 {
 	if (stem->isCustom())
 		return 1.0f;
@@ -272,23 +486,23 @@ float PatternGenerator::setPath(Stem *stem, Vec3 direction, float collarLength,
 
 	for (int i = 0; i < points; i++) {
 		control = control + increment * direction;
-		control.x += dis(this->mt) * data.noise;
-		control.y += dis(this->mt) * data.noise;
-		control.z += dis(this->mt) * data.noise;
+		control.x += dis(random) * data.noise;
+		control.y += dis(random) * data.noise;
+		control.z += dis(random) * data.noise;
 
 		length += magnitude(controls.back() - control);
 		controls.push_back(control);
 
-		pathRatio = bifurcatePath(stem, i, points, data);
+		pathRatio = bifurcatePath(stem, i, points, data, random);
 		if (pathRatio != 1.0f)
 			break;
 
 		Vec3 change;
 		float scale = 1.0f/(1.0f+pi*radius*radius*length) * 0.1f;
 		float pull = sqrt(control.x*control.x + control.y*control.y);
-		change.x = dis(this->mt) * scale;
-		change.y = dis(this->mt) * scale;
-		change.z = dis(this->mt) * scale;
+		change.x = dis(random) * scale;
+		change.y = dis(random) * scale;
+		change.z = dis(random) * scale;
 		change.z -= data.gravity * pull;
 		direction = normalize(direction + change);
 	}
@@ -302,15 +516,15 @@ float PatternGenerator::setPath(Stem *stem, Vec3 direction, float collarLength,
 }
 
 float PatternGenerator::bifurcatePath(Stem *stem, int index, int points,
-	const StemData &data)
+	const StemData &data, Random &random)
 {
-	if (index < points-1 && occurs(data.fork)) {
+	if (index < points-1 && occurs(data.fork, random)) {
 		float radius = stem->getMaxRadius();
-		unsigned curve = stem->getRadiusCurve();
-		Spline spline = this->plant->getCurve(curve).getSpline();
+		const Curve &curve = this->plant->getCurves()[
+			stem->getRadiusCurve()];
 		float t = static_cast<float>(index + 1);
 		t /= static_cast<float>(points);
-		radius *= spline.getPoint(t).y;
+		radius *= curve.getValue(t);
 		if (radius > data.radiusThreshold) {
 			stem->setMinRadius(radius);
 			return t;
@@ -319,7 +533,8 @@ float PatternGenerator::bifurcatePath(Stem *stem, int index, int points,
 	return 1.0f;
 }
 
-void PatternGenerator::addLeaves(Stem *stem, Length length, LeafData data)
+void PatternGenerator::addLeaves(Stem *stem, Length length,
+	const LeafData &data, const CurveTable &density)
 {
 	if (data.density <= 0.0f || data.leavesPerNode < 1)
 		return;
@@ -332,7 +547,7 @@ void PatternGenerator::addLeaves(Stem *stem, Length length, LeafData data)
 
 	for (int i = 0, j = 1; position > end; i++, j++) {
 		float ratio = position / length.total;
-		float t = data.densityCurve.getPoint(ratio).y;
+		float t = density.getValue(ratio);
 		if (t == 0.0f)
 			break;
 
@@ -349,8 +564,8 @@ void PatternGenerator::addLeaves(Stem *stem, Length length, LeafData data)
 	}
 }
 
-bool PatternGenerator::occurs(float percentage)
+bool PatternGenerator::occurs(float percentage, Random &random)
 {
 	std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
-	return dis(this->mt) - (1.0f-percentage*2.0f) > 0.0f;
+	return dis(random) - (1.0f-percentage*2.0f) > 0.0f;
 }
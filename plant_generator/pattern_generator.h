@@ -16,8 +16,15 @@
 #ifndef PG_PATTERN_GENERATOR_H
 #define PG_PATTERN_GENERATOR_H
 
+#include "curve.h"
 #include "plant.h"
+#include <cstdint>
+#include <functional>
 #include <random>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace pg {
 	class PatternGenerator {
@@ -27,29 +34,110 @@ namespace pg {
 			Length(float c, float t) : current(c), total(t) {}
 		};
 
+		/* A counter-based random number generator. The numbers of a
+		stem only depend on a key that is derived from the seed, the
+		parameter nodes and the lateral indices that lead to the stem,
+		so stems can be generated in any order. */
+		class Random {
+			uint64_t key;
+			uint64_t counter;
+
+		public:
+			typedef uint32_t result_type;
+			Random(uint64_t key);
+			Random getStream(uint64_t index) const;
+			result_type operator()();
+			static constexpr result_type min() {return 0;}
+			static constexpr result_type max() {return UINT32_MAX;}
+		};
+
+		/* A lateral stem whose path and descendants are generated
+		after its siblings are added. */
+		struct Lateral {
+			Stem *stem;
+			Vec3 direction;
+			float collarLength;
+			const ParameterNode *node;
+			Random random;
+		};
+
+		/* What is needed to add the laterals and leaves of the child
+		nodes of a parameter node to a stem again. */
+		struct Record {
+			const ParameterNode *node;
+			Length length;
+			Random random;
+		};
+
+		/* The stems that are generated by one thread. Laterals are
+		collected instead of being generated if defer is true. */
+		struct Task {
+			bool defer;
+			std::vector<Lateral> laterals;
+			std::vector<std::pair<const Stem *, Record>> records;
+		};
+
+		/* The curves of a parameter node as tables. */
+		struct Curves {
+			CurveTable density;
+			CurveTable incline;
+			CurveTable leafDensity;
+		};
+
 		Plant *plant;
 		ParameterTree parameterTree;
-		std::mt19937 mt;
+		std::unordered_map<const Stem *, Record> records;
+		std::unordered_map<const ParameterNode *, Curves> curves;
 
-		void addLateralStems(Stem *, Length, const ParameterNode *);
-		void addLateralStem(Stem *, float, Length, int, Vec3 &, Vec3 &,
-			const ParameterNode *);
-		float modifyRadius(const StemData &, float);
+		bool updateParameterTree(const ParameterTree &);
+		void setCurves(const ParameterNode *);
+		void grow(Stem *, Vec3, const ParameterNode *);
+		void forEach(int, const std::function<void(Task &, int)> &);
+		void addRecords(const Task &);
+		void removeRecords(const Stem *);
+		void getStems(Stem *, const ParameterNode *,
+			std::vector<Stem *> &);
+		void removeLaterals(Stem *, const ParameterNode *);
+		void addNodes(Stem *, const Record &, Task &);
+		void addLateralStems(Stem *, Length, const ParameterNode *,
+			Random &, Task &);
+		void addLateralStem(Stem *, float, Length, int, Vec3 &,
+			Vec3 &, const ParameterNode *, Random &, Task &);
+		float modifyRadius(const StemData &, float, Random &);
 		Vec3 getDirection(Stem *, int, Length, Vec3, Vec3,
-			const StemData &);
-		Vec3 getForkDirection(Stem *, float, const StemData &);
-		float addStems(Stem *, float, float, const ParameterNode *);
+			const StemData &, const CurveTable &, Random &);
+		Vec3 getForkDirection(
+			Stem *, float, const StemData &, Random &);
+		float addStems(Stem *, float, float, const ParameterNode *,
+			Random &, Task &);
 		float getCollarLength(Stem *, Vec3);
-		float setPath(Stem *, Vec3, float, const StemData &);
-		float bifurcatePath(Stem *, int, int, const StemData &);
-		void addLeaves(Stem *, Length, LeafData);
-		bool occurs(float);
+		float setPath(Stem *, Vec3, float, const StemData &, Random &);
+		float bifurcatePath(Stem *, int, int, const StemData &,
+			Random &);
+		void addLeaves(Stem *, Length, const LeafData &,
+			const CurveTable &);
+		bool occurs(float, Random &);
 
 	public:
+		/** The number of threads that the laterals of the first stem
+		are divided between. All available hardware threads are used if
+		the value is zero. The plant is the same for any number of
+		threads. */
+		int threads;
+
 		PatternGenerator(Plant *plant);
 		void grow();
 		void grow(Stem *stem);
-		void reset();
+		/** Regenerate the stems and leaves of a parameter node and
+		its siblings after the data of the node changed. The stems of
+		other nodes are kept. The stem must have been generated by
+		this generator and the structure of its parameter tree must be
+		the same. Returns false if the stems were not regenerated. */
+		bool grow(Stem *stem, std::string name);
+		/** Forget the stems that were generated for a stem and its
+		descendants. This should be called before the stems are deleted
+		elsewhere, since new stems can reuse their memory. */
+		void forget(Stem *stem);
 		void setParameterTree(ParameterTree parameterTree);
 		ParameterTree getParameterTree() const;
 	};
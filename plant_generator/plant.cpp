@@ -127,6 +127,22 @@ const Stem *Plant::getRoot() const
 	return this->root;
 }
 
+void Plant::updateLocations()
+{
+	if (this->root)
+		updateLocations(this->root);
+}
+
+void Plant::updateLocations(const Stem *stem)
+{
+	stem->getLocation();
+	const Stem *child = stem->getChild();
+	while (child) {
+		updateLocations(child);
+		child = child->getSibling();
+	}
+}
+
 Stem *Plant::getLastSibling(Stem *stem)
 {
 	if (!stem)
@@ -211,6 +227,27 @@ void Plant::deleteStem(Stem *stem)
 	deallocateStems(stem);
 }
 
+void Plant::deleteStems(const vector<Stem *> &stems)
+{
+	vector<Stem *> descendants;
+	for (Stem *stem : stems) {
+		decouple(stem);
+		getDescendants(stem, descendants);
+	}
+	this->stemPool.deallocate(descendants);
+}
+
+/** Append a stem and its descendants. */
+void Plant::getDescendants(Stem *stem, vector<Stem *> &stems)
+{
+	stems.push_back(stem);
+	Stem *child = stem->child;
+	while (child) {
+		getDescendants(child, stems);
+		child = child->nextSibling;
+	}
+}
+
 void Plant::copy(vector<Stem> &stems, Stem *stem)
 {
 	Stem *child = stem->child;
@@ -247,7 +284,10 @@ void Plant::extractStems(Stem *stem, vector<Stem> &stems)
 
 void Plant::reinsertStem(Stem &extraction)
 {
-	Stem *stem = this->stemPool.allocate();
+	/* Stems are not always allocated in the order that they were
+	returned, e.g. when they are generated in parallel. */
+	Stem *stem = this->stemPool.allocate(extraction.child);
+	/* Later extractions refer to the stem by its address. */
 	assert(extraction.child == stem);
 
 	*stem = extraction;
@@ -273,16 +313,26 @@ void Plant::reinsertStems(vector<Stem> &extractions)
 float Plant::getRadius(Stem *stem, unsigned index) const
 {
 	float t = stem->path.getPercentage(index);
-	const Spline spline = this->curves[stem->getRadiusCurve()].getSpline();
-	float z = spline.getPoint(t).y;
+	float z = this->curves[stem->getRadiusCurve()].getValue(t);
 	return z * (stem->maxRadius - stem->minRadius) + stem->minRadius;
 }
 
+void Plant::getRadii(
+	const Stem *stem, size_t start, size_t end, float *radii) const
+{
+	for (size_t i = start; i < end; i++)
+		radii[i-start] = stem->path.getPercentage(i);
+	const Curve &curve = this->curves[stem->getRadiusCurve()];
+	curve.getValues(radii, radii, end - start);
+	float scale = stem->maxRadius - stem->minRadius;
+	for (size_t i = 0; i < end - start; i++)
+		radii[i] = radii[i] * scale + stem->minRadius;
+}
+
 float Plant::getIntermediateRadius(Stem *stem, float t) const
 {
 	float length = stem->path.getLength();
-	const Spline spline = this->curves[stem->getRadiusCurve()].getSpline();
-	float z = spline.getPoint(t / length).y;
+	float z = this->curves[stem->getRadiusCurve()].getValue(t / length);
 	return z * (stem->maxRadius - stem->minRadius) + stem->minRadius;
 }
 
@@ -39,17 +39,24 @@ namespace pg {
 		void setDefault();
 		StemPool *getStemPool();
 
-		/** Add a new stem to the plant at a parent stem. */
+		/** Add a new stem to the plant at a parent stem. Stems can be
+		added to different parents from several threads at once. */
 		Stem *addStem(Stem *parent);
 		/** Remove all stems from the plant and create a new root. */
 		Stem *createRoot();
 		/** Delete a stem. */
 		void deleteStem(Stem *stem);
+		/** Delete stems that are not descendants of each other at
+		once. */
+		void deleteStems(const std::vector<Stem *> &stems);
 		/** Return the root or trunk of the plant. */
 		Stem *getRoot();
 		const Stem *getRoot() const;
 		/** Remove all stems in the plant. */
 		void removeRoot();
+		/** Compute the locations of stems that moved from the root
+		down. The stems can then be read from several threads. */
+		void updateLocations();
 		/** Remove all resources. */
 		void erase();
 
@@ -63,6 +70,10 @@ namespace pg {
 		void reinsertStems(std::vector<Stem> &stem);
 
 		float getRadius(Stem *stem, unsigned index) const;
+		/** Return the radii at the points of a path from start to
+		end at once. */
+		void getRadii(const Stem *stem, size_t start, size_t end,
+			float *radii) const;
 		float getIntermediateRadius(Stem *stem, float t) const;
 
 		void addCurve(Curve curve);
@@ -95,6 +106,8 @@ namespace pg {
 		void removeLeafMesh(Stem *, unsigned);
 
 		void deallocateStems(Stem *);
+		void getDescendants(Stem *, std::vector<Stem *> &);
+		void updateLocations(const Stem *);
 		void insertStem(Stem *, Stem *, Stem *);
 		void insertStemAfterSibling(Stem *, Stem *, Stem *);
 		void insertStemBeforeSibling(Stem *, Stem *, Stem *);
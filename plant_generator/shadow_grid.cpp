@@ -0,0 +1,214 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "shadow_grid.h"
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using pg::ShadowGrid;
+using pg::Vec3;
+using pg::Volume;
+
+/* Weights of the blur that spreads shadows into a cone. */
+const float center = 0.5f;
+const float side = 0.25f;
+
+namespace {
+	/* Blocks each thread until every thread has reached the barrier. */
+	class Barrier {
+		std::mutex mutex;
+		std::condition_variable condition;
+		int threads;
+		int waiting;
+		int generation;
+
+	public:
+		Barrier(int threads) :
+			threads(threads),
+			waiting(0),
+			generation(0)
+		{
+
+		}
+
+		void wait()
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+			int generation = this->generation;
+			if (++this->waiting == this->threads) {
+				this->waiting = 0;
+				this->generation++;
+				this->condition.notify_all();
+			} else
+				this->condition.wait(lock, [&] () {
+					return generation != this->generation;
+				});
+		}
+	};
+}
+
+ShadowGrid::ShadowGrid() : resolution(0), min(0.0f, 0.0f, 0.0f), cell(1.0f)
+{
+
+}
+
+void ShadowGrid::setVolume(Volume *volume, int depth)
+{
+	const Volume::Node *root = volume->getRoot();
+	this->resolution = 1 << depth;
+	this->min = root->getCenter() - root->getSize()*Vec3(1.0f, 1.0f, 1.0f);
+	this->cell = 2.0f * root->getSize() / this->resolution;
+	size_t size = this->resolution;
+	this->density.assign(size*size*size, 0.0f);
+	this->shadow.assign(size*size*size, 0.0f);
+	this->buffer.assign(size*size, 0.0f);
+	volume->reduce([this] (Volume::Node *node) {
+		if (!node->getNode(0) && node->getDensity() > 0.0f)
+			addDensity(node);
+	});
+}
+
+/** Leaves that are smaller than a cell add their density in proportion to
+the fraction of the cell that they fill. */
+void ShadowGrid::addDensity(const Volume::Node *node)
+{
+	float size = 2.0f * node->getSize();
+	float fraction = std::min(size / this->cell, 1.0f);
+	float density = node->getDensity() * fraction * fraction * fraction;
+	Vec3 c = node->getCenter() - this->min;
+	const float p[3] = {c.x, c.y, c.z};
+	int first[3];
+	int last[3];
+	int n = this->resolution;
+	for (int i = 0; i < 3; i++) {
+		first[i] = std::floor((p[i] - 0.5f*size) / this->cell);
+		last[i] = std::ceil((p[i] + 0.5f*size) / this->cell) - 1;
+		first[i] = std::max(std::min(first[i], n-1), 0);
+		last[i] = std::max(std::min(last[i], n-1), first[i]);
+	}
+	for (int z = first[2]; z <= last[2]; z++)
+		for (int y = first[1]; y <= last[1]; y++)
+			for (int x = first[0]; x <= last[0]; x++)
+				this->density[getIndex(x, y, z)] += density;
+}
+
+void ShadowGrid::propagate(int threads)
+{
+	int rows = this->resolution;
+	if (threads <= 0)
+		threads = std::thread::hardware_concurrency();
+	threads = std::max(std::min(threads, rows), 1);
+
+	/* The threads are started once for every slab. Each pass reads rows
+	that other threads wrote in the previous pass, so the threads wait for
+	each other after each pass. */
+	Barrier barrier(threads);
+	auto work = [&] (int i) {
+		int start = rows * i / threads;
+		int end = rows * (i+1) / threads;
+		for (int z = this->resolution - 2; z >= 0; z--) {
+			for (int pass = 0; pass < 2; pass++) {
+				propagate(z, pass, start, end);
+				barrier.wait();
+			}
+		}
+	};
+	std::vector<std::thread> workers;
+	for (int i = 1; i < threads; i++)
+		workers.emplace_back(work, i);
+	work(0);
+	for (std::thread &worker : workers)
+		worker.join();
+}
+
+/** The first pass blurs the shadow and density of the slab above along the
+x axis and the second pass blurs the result along the y axis. */
+void ShadowGrid::propagate(int z, int pass, int start, int end)
+{
+	int n = this->resolution;
+	if (pass == 0) {
+		const float *s = &this->shadow[getIndex(0, 0, z+1)];
+		const float *d = &this->density[getIndex(0, 0, z+1)];
+		for (int y = start; y < end; y++) {
+			const float *sr = s + y*n;
+			const float *dr = d + y*n;
+			float *row = &this->buffer[y*n];
+			for (int x = 0; x < n; x++) {
+				float value = center * (sr[x] + dr[x]);
+				if (x > 0)
+					value += side * (sr[x-1] + dr[x-1]);
+				if (x < n-1)
+					value += side * (sr[x+1] + dr[x+1]);
+				row[x] = value;
+			}
+		}
+	} else {
+		float *s = &this->shadow[getIndex(0, 0, z)];
+		for (int y = start; y < end; y++) {
+			const float *row = &this->buffer[y*n];
+			const float *prev = y > 0 ? row - n : nullptr;
+			const float *next = y < n-1 ? row + n : nullptr;
+			float *sr = s + y*n;
+			for (int x = 0; x < n; x++) {
+				float value = center * row[x];
+				if (prev)
+					value += side * prev[x];
+				if (next)
+					value += side * next[x];
+				sr[x] = value;
+			}
+		}
+	}
+}
+
+Vec3 ShadowGrid::getFlux(Vec3 point) const
+{
+	point -= this->min;
+	const float p[3] = {point.x, point.y, point.z};
+	int c[3];
+	for (int i = 0; i < 3; i++) {
+		c[i] = std::floor(p[i] / this->cell);
+		c[i] = std::max(std::min(c[i], this->resolution-1), 0);
+	}
+	int x0 = std::max(c[0]-1, 0);
+	int x1 = std::min(c[0]+1, this->resolution-1);
+	int y0 = std::max(c[1]-1, 0);
+	int y1 = std::min(c[1]+1, this->resolution-1);
+	Vec3 direction;
+	direction.x = getShadow(x1, c[1], c[2]) - getShadow(x0, c[1], c[2]);
+	direction.y = getShadow(c[0], y1, c[2]) - getShadow(c[0], y0, c[2]);
+	direction.z = -1.0f;
+	float light = 1.0f - getShadow(c[0], c[1], c[2]);
+	return std::max(light, 0.0f) * normalize(direction);
+}
+
+float ShadowGrid::getShadow(int x, int y, int z) const
+{
+	return this->shadow[getIndex(x, y, z)];
+}
+
+int ShadowGrid::getResolution() const
+{
+	return this->resolution;
+}
+
+size_t ShadowGrid::getIndex(int x, int y, int z) const
+{
+	size_t n = this->resolution;
+	return (z*n + y)*n + x;
+}
@@ -0,0 +1,60 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PG_SHADOW_GRID_H
+#define PG_SHADOW_GRID_H
+
+#include "volume.h"
+#include "math/vec3.h"
+#include <vector>
+
+namespace pg {
+	/** A uniform grid of shadow values over a volume. Every occupied
+	cell casts a cone of shadow on the cells below it. The cone is
+	approximated by blurring the shadow of each horizontal slab onto the
+	slab below it, so the shadow of the whole grid is computed in a single
+	downward sweep. */
+	class ShadowGrid {
+	public:
+		ShadowGrid();
+		/** Resample the density of the leaf nodes of a volume onto a
+		grid with 2^depth cells along each axis. */
+		void setVolume(Volume *volume, int depth);
+		/** Compute the shadow of each slab from the slabs above it. The
+		rows of each slab are divided between threads that are started
+		once. */
+		void propagate(int threads = 1);
+		/** Return the light that reaches a point. The direction points
+		away from the shadows around the point and the magnitude is the
+		fraction of light that is not blocked. */
+		Vec3 getFlux(Vec3 point) const;
+		float getShadow(int x, int y, int z) const;
+		int getResolution() const;
+
+	private:
+		int resolution;
+		Vec3 min;
+		float cell;
+		std::vector<float> density;
+		std::vector<float> shadow;
+		std::vector<float> buffer;
+
+		size_t getIndex(int x, int y, int z) const;
+		void addDensity(const Volume::Node *);
+		void propagate(int, int, int, int);
+	};
+}
+
+#endif
@@ -0,0 +1,120 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sky.h"
+#include <algorithm>
+#include <cmath>
+
+using pg::Sky;
+using pg::Vec3;
+
+const float pi = 3.14159265359f;
+
+/* The relative radiance of the CIE standard overcast sky. */
+static float getRadiance(float cosZenith)
+{
+	return (1.0f + 2.0f*cosZenith) / 3.0f;
+}
+
+Sky::Sky(int divisions) : rings(0), sectors(0)
+{
+	setDivisions(divisions);
+}
+
+void Sky::setDivisions(int divisions)
+{
+	if (divisions == this->rings)
+		return;
+	this->rings = divisions;
+	this->sectors = 4 * divisions;
+	int size = this->rings * this->sectors;
+	this->weights.resize(size);
+	this->distribution.resize(size);
+
+	float total = 0.0f;
+	float sectorAngle = 2.0f * pi / this->sectors;
+	for (int i = 0; i < this->rings; i++) {
+		float cos1 = std::cos(0.5f * pi * i / this->rings);
+		float cos2 = std::cos(0.5f * pi * (i+1) / this->rings);
+		float solidAngle = sectorAngle * (cos1 - cos2);
+		float cosZenith = 0.5f * (cos1 + cos2);
+		float sinZenith = std::sqrt(1.0f - cosZenith*cosZenith);
+		for (int j = 0; j < this->sectors; j++) {
+			/* The visible area of a cube. */
+			float azimuth = (j + 0.5f) * sectorAngle;
+			float area = cosZenith;
+			area += sinZenith * std::abs(std::cos(azimuth));
+			area += sinZenith * std::abs(std::sin(azimuth));
+			float weight = getRadiance(cosZenith) * solidAngle;
+			weight *= area;
+			this->weights[i*this->sectors + j] = weight;
+			total += weight;
+		}
+	}
+
+	float sum = 0.0f;
+	for (int i = 0; i < size; i++) {
+		this->weights[i] /= total;
+		sum += this->weights[i];
+		this->distribution[i] = sum;
+	}
+	if (size > 0)
+		this->distribution.back() = 1.0f;
+}
+
+int Sky::getDivisions() const
+{
+	return this->rings;
+}
+
+int Sky::getBinCount() const
+{
+	return this->weights.size();
+}
+
+float Sky::getWeight(int bin) const
+{
+	return this->weights[bin];
+}
+
+int Sky::getBin(float &u) const
+{
+	auto it = std::upper_bound(
+		this->distribution.begin(), this->distribution.end(), u);
+	int bin = std::min(
+		static_cast<int>(it - this->distribution.begin()),
+		getBinCount() - 1);
+	float start = bin > 0 ? this->distribution[bin-1] : 0.0f;
+	u = (u - start) / this->weights[bin];
+	u = std::min(std::max(u, 0.0f), 0.99999994f);
+	return bin;
+}
+
+/** Directions are uniformly distributed over the solid angle of a bin. */
+Vec3 Sky::getDirection(int bin, float u, float v) const
+{
+	int ring = bin / this->sectors;
+	int sector = bin % this->sectors;
+	float cos1 = std::cos(0.5f * pi * ring / this->rings);
+	float cos2 = std::cos(0.5f * pi * (ring+1) / this->rings);
+	float cosZenith = cos1 + u * (cos2 - cos1);
+	float sinZenith = std::sqrt(std::max(1.0f - cosZenith*cosZenith, 0.0f));
+	float azimuth = (sector + v) * 2.0f * pi / this->sectors;
+	Vec3 direction;
+	direction.x = -sinZenith * std::cos(azimuth);
+	direction.y = -sinZenith * std::sin(azimuth);
+	direction.z = -cosZenith;
+	return direction;
+}
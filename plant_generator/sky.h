@@ -0,0 +1,52 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PG_SKY_H
+#define PG_SKY_H
+
+#include "math/vec3.h"
+#include <vector>
+
+namespace pg {
+	/** A dome of light divided into rings of equal elevation and sectors
+	of equal azimuth. The radiance follows a standard overcast sky. Each
+	bin is weighted by the light that it sends into a cube so that the
+	directions of rays can be sampled in proportion to their energy. */
+	class Sky {
+	public:
+		Sky(int divisions = 0);
+		/** Set the number of rings. Each ring has four times as many
+		sectors. The tables are only rebuilt if the value changes. */
+		void setDivisions(int divisions);
+		int getDivisions() const;
+		int getBinCount() const;
+		/** Return the probability of sampling a bin. */
+		float getWeight(int bin) const;
+		/** Return the bin that a number in [0, 1) falls into. The
+		number is rescaled to [0, 1) within the bin. */
+		int getBin(float &u) const;
+		/** Return a downward direction within a bin for two numbers in
+		the interval [0, 1). */
+		Vec3 getDirection(int bin, float u, float v) const;
+
+	private:
+		int rings;
+		int sectors;
+		std::vector<float> weights;
+		std::vector<float> distribution;
+	};
+}
+
+#endif
@@ -72,7 +72,7 @@ void Spline::addControl(Vec3 control)
 	this->controls.push_back(control);
 }
 
-std::vector<Vec3> Spline::getControls() const
+const std::vector<Vec3> &Spline::getControls() const
 {
 	return controls;
 }
@@ -115,7 +115,14 @@ Vec3 Spline::getPoint(int curve, float t) const
 	return getBezier(t, &controls[index], (degree + 1));
 }
 
-Vec3 Spline::getDirection(unsigned index)
+void Spline::getPoints(
+	int curve, float start, float delta, int count, Vec3 *points) const
+{
+	int index = degree * curve;
+	getBezier(&controls[index], degree + 1, start, delta, count, points);
+}
+
+Vec3 Spline::getDirection(unsigned index) const
 {
 	if (index == controls.size() - 1)
 		return pg::normalize(controls[index] - controls[index - 1]);
@@ -54,7 +54,7 @@ namespace pg {
 		void setDefault(unsigned type);
 		void setControls(std::vector<Vec3> controls);
 		void addControl(Vec3 control);
-		std::vector<Vec3> getControls() const;
+		const std::vector<Vec3> &getControls() const;
 		int getSize() const;
 		int getCurveCount() const;
 		/** 1 = linear, 2 = quadratic, 3 = cubic, . . . */
@@ -62,7 +62,11 @@ namespace pg {
 		int getDegree() const;
 		Vec3 getPoint(float t) const;
 		Vec3 getPoint(int curve, float t) const;
-		Vec3 getDirection(unsigned index);
+		/** Evaluate count evenly spaced points of a curve. */
+		void getPoints(
+			int curve, float start, float delta, int count,
+			Vec3 *points) const;
+		Vec3 getDirection(unsigned index) const;
 		/** Returns the index of the center point of the insertion */
 		int insert(unsigned index, Vec3 point);
 		void remove(unsigned index);
@@ -0,0 +1,133 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "stand_generator.h"
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+using pg::Generator;
+using pg::Obstacles;
+using pg::StandGenerator;
+using pg::Vec3;
+
+StandGenerator::StandGenerator() : light(nullptr), cycles(5), nodes(4)
+{
+
+}
+
+Generator *StandGenerator::addPlant(Plant *plant, Vec3 location)
+{
+	this->generators.emplace_back(new Generator(plant));
+	Generator *generator = this->generators.back().get();
+	generator->offset = location;
+	return generator;
+}
+
+size_t StandGenerator::getPlantCount() const
+{
+	return this->generators.size();
+}
+
+void StandGenerator::grow()
+{
+	this->light.mt.seed(this->light.seed);
+	/* Pruned segments would be removed from the shared volume by several
+	threads at once. */
+	forEachPlant([] (Generator *generator) {
+		generator->incremental = false;
+		generator->initialize();
+	});
+
+	for (int i = 0; i < this->cycles; i++) {
+		if (i > 0) {
+			forEachPlant([this] (Generator *generator) {
+				Volume *volume = &this->volume;
+				Stem *root = generator->plant->getRoot();
+				generator->prune(volume, root);
+				generator->addStems(root, volume);
+			});
+		}
+
+		for (int j = 0; j < this->nodes; j++) {
+			updateVolume();
+			this->light.updateLight(&this->volume);
+			forEachPlant([this, j] (Generator *generator) {
+				Stem *root = generator->plant->getRoot();
+				generator->setConcentration(root);
+				generator->addNodes(
+					&this->volume, root, j, this->nodes);
+			});
+		}
+	}
+}
+
+/** The volume is wide enough to contain every plant and the obstacles.
+Plants are added one at a time because adding lines divides nodes. */
+void StandGenerator::updateVolume()
+{
+	float width = 1.0f;
+	for (const auto &generator : this->generators)
+		width = std::max(width, generator->width);
+	this->light.width = width;
+	if (this->light.obstacles) {
+		const Obstacles *obstacles = this->light.obstacles;
+		this->light.updateBoundingBox(obstacles->getMin());
+		this->light.updateBoundingBox(obstacles->getMax());
+		width = this->light.width;
+	}
+
+	int depth = std::log2(width) + this->light.depth;
+	if (depth <= 0)
+		depth = 1;
+	this->volume.clear(width*2.0f, depth);
+	for (const auto &generator : this->generators) {
+		Stem *root = generator->plant->getRoot();
+		generator->addToVolume(&this->volume, root);
+	}
+	if (this->light.obstacles)
+		this->light.obstacles->merge(&this->volume);
+}
+
+/** Each plant only reads the shared volume, so plants can be grown at the
+same time. */
+void StandGenerator::forEachPlant(
+	const std::function<void(Generator *)> &function)
+{
+	int size = this->generators.size();
+	std::atomic<int> next(0);
+	auto grow = [&] () {
+		int index;
+		while ((index = next++) < size)
+			function(this->generators[index].get());
+	};
+
+	int threads = this->light.threads;
+	if (threads <= 0)
+		threads = std::thread::hardware_concurrency();
+	if (threads > size)
+		threads = size;
+	std::vector<std::thread> workers;
+	for (int i = 1; i < threads; i++)
+		workers.emplace_back(grow);
+	grow();
+	for (std::thread &worker : workers)
+		worker.join();
+}
+
+const pg::Volume *StandGenerator::getVolume()
+{
+	return &this->volume;
+}
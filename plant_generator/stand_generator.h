@@ -0,0 +1,55 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PG_STAND_GENERATOR_H
+#define PG_STAND_GENERATOR_H
+
+#include "generator.h"
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace pg {
+	/** Grows several plants that compete for light. The plants are added
+	to a single volume and the light is computed once for the whole stand
+	in each iteration. The plants are then grown on separate threads. */
+	class StandGenerator {
+		std::vector<std::unique_ptr<Generator>> generators;
+		Volume volume;
+
+		void updateVolume();
+		void forEachPlant(const std::function<void(Generator *)> &);
+
+	public:
+		/** The light of the stand is computed with the parameters of
+		this generator, such as the number of rays, the light model and
+		the seed. Its number of threads is also used to grow the
+		plants. */
+		Generator light;
+		int cycles;
+		int nodes;
+
+		StandGenerator();
+		/** Add a plant that is grown at a location on the ground. The
+		growth parameters of the plant are set on the returned
+		generator. */
+		Generator *addPlant(Plant *plant, Vec3 location);
+		size_t getPlantCount() const;
+		void grow();
+		const Volume *getVolume();
+	};
+}
+
+#endif
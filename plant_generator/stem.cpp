@@ -33,7 +33,9 @@ Stem::Stem(Stem *parent) :
 	maxRadius(0.0f),
 	swelling(1.5f, 3.0f),
 	location(0.0f, 0.0f, 0.0f),
-	custom(false)
+	moved(false),
+	custom(false),
+	generation(0)
 {
 	if (parent)
 		this->depth = parent->depth + 1;
@@ -60,9 +62,11 @@ Stem::Stem(const Stem &original) :
 	maxRadius(original.maxRadius),
 	swelling(original.swelling),
 	location(original.location),
+	moved(original.moved),
 	path(original.path),
 	custom(original.custom),
-	parameterTree(original.parameterTree)
+	parameterTree(original.parameterTree),
+	generation(original.generation)
 {
 
 }
@@ -81,12 +85,16 @@ Stem &Stem::operator=(const Stem &stem)
 	this->sectionDivisions = stem.sectionDivisions;
 	this->distance = stem.distance;
 	this->location = stem.location;
+	this->moved = stem.moved;
 	this->material[0] = stem.material[0];
 	this->material[1] = stem.material[1];
 	this->leaves = stem.leaves;
 	this->swelling = stem.swelling;
 	this->custom = stem.custom;
 	this->parameterTree = stem.parameterTree;
+	this->state = stem.state;
+	/* The memory now holds another stem. */
+	this->generation++;
 	return *this;
 }
 
@@ -100,7 +108,7 @@ bool Stem::operator==(const Stem &stem) const
 		this->path == stem.path &&
 		this->sectionDivisions == stem.sectionDivisions &&
 		this->distance == stem.distance &&
-		this->location == stem.location &&
+		getLocation() == stem.getLocation() &&
 		this->material[0] == stem.material[0] &&
 		this->material[1] == stem.material[1] &&
 		this->swelling == stem.swelling &&
@@ -121,18 +129,21 @@ void Stem::init(Stem *parent)
 	this->sectionDivisions = 8;
 	this->custom = false;
 	this->parameterTree.reset();
+	this->state = GeneratorState();
 	this->nextSibling = nullptr;
 	this->prevSibling = nullptr;
 	this->child = nullptr;
 	this->parent = parent;
 	this->distance = 0.0f;
 	this->location = Vec3(0.0f, 0.0f, 0.0f);
+	this->moved = false;
 	this->path.setInitialDivisions(0);
 	this->path.setDivisions(0);
 	if (parent == nullptr)
 		this->depth = 0;
 	else
 		this->depth = parent->depth + 1;
+	this->generation++;
 }
 
 bool Stem::operator!=(const Stem &stem) const
@@ -226,7 +237,11 @@ void Stem::setPath(Path &path)
 {
 	this->path = path;
 	this->path.generate();
-	updatePositions(this);
+	Stem *child = this->child;
+	while (child != nullptr) {
+		child->setMoved();
+		child = child->nextSibling;
+	}
 }
 
 const Path &Stem::getPath() const
@@ -234,12 +249,30 @@ const Path &Stem::getPath() const
 	return this->path;
 }
 
-void Stem::updatePositions(Stem *stem)
+void Stem::extendPath(Vec3 control)
 {
-	Stem *child = stem->child;
+	/* Paths that are not linear are generated again, and the point
+	after the last complete curve is replaced by the new control. */
+	bool generated = this->path.getSize() < 2 ||
+		this->path.getSpline().getDegree() != 1;
+	float length = this->path.getLength();
+	this->path.addControl(control);
+	Stem *child = this->child;
 	while (child != nullptr) {
-		child->setDistance(child->distance);
-		updatePositions(child);
+		if (generated || child->distance > length)
+			child->setDistance(child->distance);
+		child = child->nextSibling;
+	}
+}
+
+/** Only flags are set, so a path that changes many times before the
+locations are read is only followed once. */
+void Stem::setMoved()
+{
+	this->moved = true;
+	Stem *child = this->child;
+	while (child != nullptr) {
+		child->setMoved();
 		child = child->nextSibling;
 	}
 }
@@ -247,14 +280,8 @@ void Stem::updatePositions(Stem *stem)
 void Stem::setDistance(float position)
 {
 	if (this->parent != nullptr) {
-		Path parentPath = this->parent->getPath();
-		Vec3 point = parentPath.getIntermediate(position);
-		if (std::isnan(point.x))
-			this->location = point;
-		else
-			this->location = parent->getLocation() + point;
 		this->distance = position;
-		updatePositions(this);
+		setMoved();
 	}
 }
 
@@ -263,8 +290,19 @@ float Stem::getDistance() const
 	return this->distance;
 }
 
+/** Ancestors that moved are located first, so reading the locations of a
+subtree from the top down follows each path once. */
 Vec3 Stem::getLocation() const
 {
+	if (this->moved) {
+		const Path &path = this->parent->path;
+		Vec3 point = path.getIntermediate(this->distance);
+		if (std::isnan(point.x))
+			this->location = point;
+		else
+			this->location = this->parent->getLocation() + point;
+		this->moved = false;
+	}
 	return this->location;
 }
 
@@ -346,6 +384,11 @@ int Stem::getDepth() const
 	return this->depth;
 }
 
+unsigned Stem::getGeneration() const
+{
+	return this->generation;
+}
+
 void Stem::setMaxRadius(float radius)
 {
 	this->maxRadius = radius;
@@ -56,20 +56,27 @@ namespace pg {
 		float minRadius;
 		float maxRadius;
 		Vec2 swelling;
-		Vec3 location;
+		/* The location is computed from the path of the parent when it
+		is requested after the stem or one of its ancestors moved. */
+		mutable Vec3 location;
+		mutable bool moved;
 		Path path;
 
 		bool custom;
 		ParameterTree parameterTree;
 		GeneratorState state;
+		/* Incremented whenever the stem is initialized so that a stem
+		that is reused by the pool is not mistaken for the stem that was
+		removed. */
+		unsigned generation;
 
-		void updatePositions(Stem *stem);
+		void setMoved();
 		void init(Stem *parent = nullptr);
 
 #ifdef PG_SERIALIZE
 		friend class boost::serialization::access;
 		template<class Archive>
-		void serialize(Archive &ar, const unsigned)
+		void serialize(Archive &ar, const unsigned version)
 		{
 			ar & nextSibling;
 			ar & prevSibling;
@@ -80,7 +87,10 @@ namespace pg {
 			ar & path;
 			ar & sectionDivisions;
 			ar & distance;
+			if (Archive::is_saving::value)
+				getLocation();
 			ar & location;
+			moved = false;
 			ar & material;
 			ar & swelling;
 			ar & radiusCurve;
@@ -89,6 +99,8 @@ namespace pg {
 			ar & joints;
 			ar & custom;
 			ar & parameterTree;
+			if (version >= 1)
+				ar & state;
 		}
 #endif
 
@@ -129,8 +141,13 @@ namespace pg {
 		int getCollarDivisions() const;
 		void setPath(Path &path);
 		const Path &getPath() const;
+		/** Add a control to the end of the path. Only children beyond
+		the previous end of the path are moved. */
+		void extendPath(Vec3 control);
 		void setSwelling(Vec2 scale);
 		Vec2 getSwelling() const;
+		/** Set the distance along the parent path. The locations of
+		the stem and its descendants are updated when requested. */
 		void setDistance(float distance);
 		float getDistance() const;
 		Vec3 getLocation() const;
@@ -152,7 +169,14 @@ namespace pg {
 
 		bool isDescendantOf(Stem *stem) const;
 		int getDepth() const;
+		/** Returns the number of times that the memory of the stem was
+		initialized. */
+		unsigned getGeneration() const;
 	};
 }
 
+#ifdef PG_SERIALIZE
+BOOST_CLASS_VERSION(pg::Stem, 1)
+#endif
+
 #endif
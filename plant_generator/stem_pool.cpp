@@ -14,7 +14,9 @@
  */
 
 #include "stem_pool.h"
+#include <algorithm>
 #include <cassert>
+#include <utility>
 
 using namespace pg;
 using std::list;
@@ -26,16 +28,41 @@ StemPool::StemPool() : firstAvailable(nullptr), counter(0)
 }
 
 Stem *StemPool::allocate()
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return allocateAvailable();
+}
+
+Stem *StemPool::allocate(Stem *stem)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	/* The pool is released if it was shrunk, and the stem is no longer
+	available if it was allocated again. */
+	auto pool = getPool(stem);
+	if (pool == this->pools.end())
+		return allocateAvailable();
+	size_t index = stem - &pool->stems[0];
+	if (!pool->available[index])
+		return allocateAvailable();
+	pool->remaining--;
+	pool->available[index] = false;
+	removeAvailable(stem);
+	return stem;
+}
+
+Stem *StemPool::allocateAvailable()
 {
 	Stem *stem = this->firstAvailable;
-	if (stem) {
-		auto pool = getPool(stem);
-		pool->remaining--;
-	} else {
-		Pool &pool = addPool();
+	Pool *pool;
+	if (stem)
+		pool = &*getPool(stem);
+	else {
+		pool = &addPool();
 		stem = this->firstAvailable;
-		pool.remaining--;
 	}
+	assert(pool->available[stem - &pool->stems[0]]);
+	pool->remaining--;
+	pool->available[stem - &pool->stems[0]] = false;
 	this->firstAvailable = this->firstAvailable->nextAvailable;
 	if (this->firstAvailable)
 		this->firstAvailable->prevAvailable = nullptr;
@@ -50,6 +77,7 @@ StemPool::Pool &StemPool::addPool()
 	Pool &pool = this->pools.back();
 	pool.id = ++this->counter;
 	pool.remaining = PG_POOL_SIZE;
+	pool.available.set();
 	this->firstAvailable = &pool.stems[0];
 
 	Stem *next = this->firstAvailable;
@@ -67,8 +95,64 @@ StemPool::Pool &StemPool::addPool()
 
 size_t StemPool::deallocate(Stem *stem)
 {
+	std::lock_guard<std::mutex> lock(this->mutex);
 	list<Pool>::iterator it = getPool(stem);
 	it->remaining++;
+	it->available[stem - &it->stems[0]] = true;
+	addAvailable(stem);
+	return it->remaining;
+}
+
+void StemPool::deallocate(const std::vector<Stem *> &stems)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	typedef std::pair<const Stem *, Pool *> Range;
+	std::vector<Range> pools;
+	for (Pool &pool : this->pools)
+		pools.push_back(Range(&pool.stems[0], &pool));
+	std::sort(pools.begin(), pools.end());
+
+	auto compare = [] (const Stem *stem, const Range &range) {
+		return stem < range.first;
+	};
+	for (Stem *stem : stems) {
+		auto it = std::upper_bound(
+			pools.begin(), pools.end(), stem, compare);
+		assert(it != pools.begin());
+		Pool *pool = (--it)->second;
+		pool->remaining++;
+		pool->available[stem - &pool->stems[0]] = true;
+		addAvailable(stem);
+	}
+}
+
+size_t StemPool::shrink()
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	size_t count = 0;
+	auto it = this->pools.begin();
+	while (it != this->pools.end()) {
+		if (it->remaining == PG_POOL_SIZE) {
+			for (Stem &stem : it->stems)
+				removeAvailable(&stem);
+			it = this->pools.erase(it);
+			count++;
+		} else
+			it++;
+	}
+	return count;
+}
+
+size_t StemPool::getStemCount() const
+{
+	size_t count = 0;
+	for (const auto &pool : this->pools)
+		count += PG_POOL_SIZE - pool.remaining;
+	return count;
+}
+
+void StemPool::addAvailable(Stem *stem)
+{
 	if (this->firstAvailable) {
 		stem->prevAvailable = nullptr;
 		this->firstAvailable->prevAvailable = stem;
@@ -79,7 +163,16 @@ size_t StemPool::deallocate(Stem *stem)
 		stem->prevAvailable = nullptr;
 		stem->nextAvailable = nullptr;
 	}
-	return it->remaining;
+}
+
+void StemPool::removeAvailable(Stem *stem)
+{
+	if (stem->prevAvailable)
+		stem->prevAvailable->nextAvailable = stem->nextAvailable;
+	else
+		this->firstAvailable = stem->nextAvailable;
+	if (stem->nextAvailable)
+		stem->nextAvailable->prevAvailable = stem->prevAvailable;
 }
 
 list<StemPool::Pool>::iterator StemPool::getPool(Stem *stem)
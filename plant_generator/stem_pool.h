@@ -18,7 +18,10 @@
 
 #include "stem.h"
 #include <array>
+#include <bitset>
 #include <list>
+#include <mutex>
+#include <vector>
 
 #define PG_POOL_SIZE 100
 
@@ -28,19 +31,42 @@ namespace pg {
 			long id;
 			size_t remaining;
 			std::array<Stem, PG_POOL_SIZE> stems;
+			/* Whether each stem is on the list of available
+			stems. */
+			std::bitset<PG_POOL_SIZE> available;
 		};
 		std::list<Pool> pools;
 		Stem *firstAvailable;
 		long counter;
+		std::mutex mutex;
 
 		Pool &addPool();
+		Stem *allocateAvailable();
 		std::list<Pool>::iterator getPool(Stem *stem);
+		void addAvailable(Stem *stem);
+		void removeAvailable(Stem *stem);
 
 	public:
 		StemPool();
 		StemPool(const StemPool &) = delete;
+		/** Stems can be allocated and returned from several threads
+		at once. */
 		Stem *allocate();
+		/** Allocate a stem that was returned to the pool, so that a
+		removed stem keeps its address when it is reinserted. Another
+		stem is allocated if the stem was reused or its pool was
+		released, so callers that rely on the address should compare
+		it. */
+		Stem *allocate(Stem *stem);
 		size_t deallocate(Stem *stem);
+		/** Return several stems at once. The pools are only searched
+		once for all of the stems. */
+		void deallocate(const std::vector<Stem *> &stems);
+		/** Release pools without allocated stems. Returns the number of
+		released pools. */
+		size_t shrink();
+		/** Return the number of allocated stems. */
+		size_t getStemCount() const;
 		long getPoolID(const Stem *stem) const;
 		size_t getRemaining(long id) const;
 		size_t getPoolCount() const;
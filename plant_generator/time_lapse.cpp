@@ -0,0 +1,327 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "time_lapse.h"
+#include <algorithm>
+#include <unordered_set>
+
+using namespace pg;
+
+TimeLapse::TimeLapse(Interval interval) :
+	interval(interval),
+	keyInterval(16),
+	stemCount(0)
+{
+
+}
+
+/** Stems are compared with their last recorded state, so the cost of a
+step depends on the number of stems and on the size of the changes but
+not on the length of the paths. */
+void TimeLapse::record(const Plant *plant)
+{
+	Step step;
+	std::unordered_map<const Stem *, State> states;
+	if (plant->getRoot())
+		record(plant->getRoot(), 0, step, states);
+
+	std::unordered_set<unsigned> removals;
+	for (const auto &state : this->states) {
+		auto it = states.find(state.first);
+		if (it == states.end() || it->second.id != state.second.id)
+			removals.insert(state.second.id);
+	}
+	for (const auto &state : this->states) {
+		unsigned id = state.second.id;
+		unsigned parent = state.second.parent;
+		if (!removals.count(id))
+			continue;
+		if (parent == id || !removals.count(parent))
+			step.removals.push_back(id);
+	}
+	std::sort(step.removals.begin(), step.removals.end());
+
+	this->states.swap(states);
+	this->steps.push_back(std::move(step));
+
+	size_t count = this->steps.size();
+	if (this->keyInterval > 0 && count % this->keyInterval == 0) {
+		Key key;
+		key.step = count - 1;
+		if (plant->getRoot())
+			addKey(plant->getRoot(), key.changes);
+		this->keys.push_back(std::move(key));
+	}
+}
+
+/** A stem is new if it was not recorded before or if it was initialized
+again after it was reused by the stem pool. Children are
+visited from last to first so that adding them to the front of their
+siblings restores their order. */
+void TimeLapse::record(
+	const Stem *stem, unsigned parent, Step &step,
+	std::unordered_map<const Stem *, State> &states)
+{
+	bool root = !stem->getParent();
+	auto it = this->states.find(stem);
+	bool added = it == this->states.end() ||
+		it->second.generation != stem->getGeneration();
+
+	State state;
+	if (added) {
+		state.id = this->stemCount++;
+		state.parent = root ? state.id : parent;
+		state.generation = stem->getGeneration();
+		state.controls = 0;
+		state.minRadius = stem->getMinRadius();
+		state.maxRadius = stem->getMaxRadius();
+		Addition addition;
+		addition.id = state.id;
+		addition.parent = state.parent;
+		addition.distance = stem->getDistance();
+		addition.swelling = stem->getSwelling();
+		addition.sectionDivisions = stem->getSectionDivisions();
+		step.additions.push_back(addition);
+		step.radii.push_back(
+			{state.id, state.minRadius, state.maxRadius});
+	} else {
+		state = std::move(it->second);
+		if (state.minRadius != stem->getMinRadius() ||
+			state.maxRadius != stem->getMaxRadius()) {
+			state.minRadius = stem->getMinRadius();
+			state.maxRadius = stem->getMaxRadius();
+			step.radii.push_back(
+				{state.id, state.minRadius, state.maxRadius});
+		}
+	}
+
+	const Spline &spline = stem->getPath().getSpline();
+	const std::vector<Vec3> &controls = spline.getControls();
+	size_t size = state.controls;
+	if (size > controls.size() ||
+		(size > 0 && controls[size-1] != state.lastControl))
+		size = 0;
+	if (size < controls.size()) {
+		Extension extension;
+		extension.id = state.id;
+		extension.size = size;
+		extension.degree = spline.getDegree();
+		extension.controls.assign(
+			controls.begin() + size, controls.end());
+		step.extensions.push_back(std::move(extension));
+		state.controls = controls.size();
+		state.lastControl = controls.back();
+	} else if (controls.empty())
+		state.controls = 0;
+
+	const std::vector<Leaf> &leaves = stem->getLeaves();
+	size = 0;
+	while (size < leaves.size() && size < state.leaves.size() &&
+		leaves[size] == state.leaves[size])
+		size++;
+	if (size < leaves.size() || size < state.leaves.size()) {
+		Leaves change;
+		change.id = state.id;
+		change.size = size;
+		change.leaves.assign(leaves.begin() + size, leaves.end());
+		step.leaves.push_back(std::move(change));
+		state.leaves = leaves;
+	}
+
+	unsigned id = state.id;
+	states.emplace(stem, std::move(state));
+
+	std::vector<const Stem *> children;
+	const Stem *child = stem->getChild();
+	while (child) {
+		children.push_back(child);
+		child = child->getSibling();
+	}
+	for (auto it = children.rbegin(); it != children.rend(); ++it)
+		record(*it, id, step, states);
+}
+
+/** The stems are added in the same order as the stems of a step. */
+void TimeLapse::addKey(const Stem *stem, Step &key) const
+{
+	const State &state = this->states.at(stem);
+	Addition addition;
+	addition.id = state.id;
+	addition.parent = state.parent;
+	addition.distance = stem->getDistance();
+	addition.swelling = stem->getSwelling();
+	addition.sectionDivisions = stem->getSectionDivisions();
+	key.additions.push_back(addition);
+	key.radii.push_back({state.id, state.minRadius, state.maxRadius});
+
+	const Spline &spline = stem->getPath().getSpline();
+	if (!spline.getControls().empty()) {
+		Extension extension;
+		extension.id = state.id;
+		extension.size = 0;
+		extension.degree = spline.getDegree();
+		extension.controls = spline.getControls();
+		key.extensions.push_back(std::move(extension));
+	}
+	if (!state.leaves.empty())
+		key.leaves.push_back({state.id, 0, state.leaves});
+
+	std::vector<const Stem *> children;
+	const Stem *child = stem->getChild();
+	while (child) {
+		children.push_back(child);
+		child = child->getSibling();
+	}
+	for (auto it = children.rbegin(); it != children.rend(); ++it)
+		addKey(*it, key);
+}
+
+void TimeLapse::clear()
+{
+	this->stemCount = 0;
+	this->steps.clear();
+	this->keys.clear();
+	this->states.clear();
+}
+
+size_t TimeLapse::getStepCount() const
+{
+	return this->steps.size();
+}
+
+const TimeLapse::Step &TimeLapse::getStep(size_t index) const
+{
+	return this->steps[index];
+}
+
+const TimeLapse::Key *TimeLapse::getKey(size_t index) const
+{
+	auto it = std::upper_bound(
+		this->keys.begin(), this->keys.end(), index,
+		[] (size_t index, const Key &key) {
+			return index < key.step;
+		});
+	if (it == this->keys.begin())
+		return nullptr;
+	return &*(it - 1);
+}
+
+TimeLapsePlayer::TimeLapsePlayer(const TimeLapse *timeLapse, Plant *plant) :
+	timeLapse(timeLapse),
+	plant(plant),
+	stepCount(0)
+{
+
+}
+
+void TimeLapsePlayer::setStep(size_t index)
+{
+	size_t count = std::min(index + 1, this->timeLapse->getStepCount());
+	const TimeLapse::Key *key = nullptr;
+	if (count > 0)
+		key = this->timeLapse->getKey(count - 1);
+	if (count < this->stepCount || (key && key->step > this->stepCount)) {
+		this->plant->removeRoot();
+		this->stems.clear();
+		this->stepCount = 0;
+		if (key) {
+			apply(key->changes);
+			this->stepCount = key->step + 1;
+		}
+	}
+	while (this->stepCount < count)
+		apply(this->timeLapse->getStep(this->stepCount++));
+}
+
+size_t TimeLapsePlayer::getStepCount() const
+{
+	return this->stepCount;
+}
+
+/* Controls are appended one at a time after the first curve so that the
+path is generated the same way as the path of the generator. */
+static void setControls(Stem *stem, const TimeLapse::Extension &extension)
+{
+	const Spline &spline = stem->getPath().getSpline();
+	const std::vector<Vec3> &current = spline.getControls();
+	if (extension.size > 0 && extension.size == current.size()) {
+		for (Vec3 control : extension.controls)
+			stem->extendPath(control);
+		return;
+	}
+
+	std::vector<Vec3> controls;
+	size_t size = std::min(extension.size, current.size());
+	controls.assign(current.begin(), current.begin() + size);
+	controls.insert(controls.end(),
+		extension.controls.begin(), extension.controls.end());
+	size = std::min(controls.size(), size_t(extension.degree + 1));
+
+	Path path;
+	Spline first;
+	first.setDegree(extension.degree);
+	first.setControls(std::vector<Vec3>(
+		controls.begin(), controls.begin() + size));
+	path.setSpline(first);
+	stem->setPath(path);
+	for (size_t i = size; i < controls.size(); i++)
+		stem->extendPath(controls[i]);
+}
+
+/** Children are positioned after the paths of their parents are set. */
+void TimeLapsePlayer::apply(const TimeLapse::Step &step)
+{
+	std::vector<Stem *> removals;
+	for (unsigned id : step.removals) {
+		if (this->stems[id] == this->plant->getRoot())
+			this->plant->removeRoot();
+		else
+			removals.push_back(this->stems[id]);
+	}
+	if (!removals.empty())
+		this->plant->deleteStems(removals);
+
+	for (const TimeLapse::Addition &addition : step.additions) {
+		Stem *stem;
+		if (addition.parent == addition.id)
+			stem = this->plant->createRoot();
+		else {
+			Stem *parent = this->stems[addition.parent];
+			stem = this->plant->addStem(parent);
+		}
+		stem->setSwelling(addition.swelling);
+		stem->setSectionDivisions(addition.sectionDivisions);
+		if (this->stems.size() <= addition.id)
+			this->stems.resize(addition.id + 1, nullptr);
+		this->stems[addition.id] = stem;
+	}
+	for (const TimeLapse::Extension &extension : step.extensions)
+		setControls(this->stems[extension.id], extension);
+	for (const TimeLapse::Addition &addition : step.additions)
+		this->stems[addition.id]->setDistance(addition.distance);
+
+	for (const TimeLapse::Radius &radius : step.radii) {
+		Stem *stem = this->stems[radius.id];
+		stem->setMinRadius(radius.minRadius);
+		stem->setMaxRadius(radius.maxRadius);
+	}
+	for (const TimeLapse::Leaves &leaves : step.leaves) {
+		Stem *stem = this->stems[leaves.id];
+		while (stem->getLeafCount() > leaves.size)
+			stem->removeLeaf(stem->getLeafCount() - 1);
+		for (const Leaf &leaf : leaves.leaves)
+			stem->addLeaf(leaf);
+	}
+}
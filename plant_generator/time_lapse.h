@@ -0,0 +1,147 @@
+/* Copyright 2021 Floris Creyf
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PG_TIME_LAPSE_H
+#define PG_TIME_LAPSE_H
+
+#include "plant.h"
+#include <unordered_map>
+#include <vector>
+
+namespace pg {
+	/** Records the growth of a plant as the changes between steps
+	instead of copies of the plant. Stems are given an identifier when
+	they are first recorded. A stem that is pruned and reused by the stem
+	pool is recorded as a new stem. Only the properties that the
+	generator changes are recorded. The whole plant is also recorded as
+	a key after a number of steps so that it can be reconstructed
+	without the earlier steps. */
+	class TimeLapse {
+	public:
+		enum Interval {Cycle, Node};
+
+		/** A stem that was added since the previous step. */
+		struct Addition {
+			unsigned id;
+			/** The parent of a root is its own identifier. */
+			unsigned parent;
+			float distance;
+			Vec2 swelling;
+			int sectionDivisions;
+		};
+
+		/** The controls of a stem are truncated to a size and the new
+		controls are appended. */
+		struct Extension {
+			unsigned id;
+			size_t size;
+			int degree;
+			std::vector<Vec3> controls;
+		};
+
+		struct Radius {
+			unsigned id;
+			float minRadius;
+			float maxRadius;
+		};
+
+		/** The leaves of a stem are truncated to a size and the new
+		leaves are appended. */
+		struct Leaves {
+			unsigned id;
+			size_t size;
+			std::vector<Leaf> leaves;
+		};
+
+		struct Step {
+			/** Descendants of removed stems are not included. */
+			std::vector<unsigned> removals;
+			/** Parents are added before their children. */
+			std::vector<Addition> additions;
+			std::vector<Extension> extensions;
+			std::vector<Radius> radii;
+			std::vector<Leaves> leaves;
+		};
+
+		/** The changes from an empty plant to a step. */
+		struct Key {
+			size_t step;
+			Step changes;
+		};
+
+		/** Record after every cycle or after every node of a
+		generator. */
+		Interval interval;
+		/** The number of steps between keys. Keys are not recorded if
+		the interval is zero. */
+		size_t keyInterval;
+
+		TimeLapse(Interval interval = Cycle);
+		/** Append the changes since the previous step. */
+		void record(const Plant *plant);
+		void clear();
+		size_t getStepCount() const;
+		const Step &getStep(size_t index) const;
+		/** Returns the last key at or before a step or nullptr if
+		there is none. */
+		const Key *getKey(size_t index) const;
+
+	private:
+		/* The last recorded state of a stem. */
+		struct State {
+			unsigned id;
+			unsigned parent;
+			unsigned generation;
+			size_t controls;
+			Vec3 lastControl;
+			float minRadius;
+			float maxRadius;
+			std::vector<Leaf> leaves;
+		};
+
+		unsigned stemCount;
+		std::vector<Step> steps;
+		std::vector<Key> keys;
+		std::unordered_map<const Stem *, State> states;
+
+		void record(
+			const Stem *, unsigned, Step &,
+			std::unordered_map<const Stem *, State> &);
+		void addKey(const Stem *, Step &) const;
+	};
+
+	/** Reconstructs a plant at any step of a time-lapse. */
+	class TimeLapsePlayer {
+	public:
+		TimeLapsePlayer(const TimeLapse *timeLapse, Plant *plant);
+		/** The steps up to and including the index are applied. Later
+		steps are applied to the current plant unless there is a key
+		between the current step and the index. Earlier steps rebuild
+		the plant from the last key before the index. */
+		void setStep(size_t index);
+		/** Returns the number of steps that are applied. */
+		size_t getStepCount() const;
+
+	private:
+		const TimeLapse *timeLapse;
+		Plant *plant;
+		size_t stepCount;
+		std::vector<Stem *> stems;
+
+		void apply(const TimeLapse::Step &);
+	};
+}
+
+#endif
@@ -14,6 +14,16 @@
  */
 
 #include "volume.h"
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <thread>
+
+#ifdef PG_SERIALIZE
+#include <boost/archive/text_iarchive.hpp>
+#include <boost/archive/text_oarchive.hpp>
+#include <boost/serialization/split_member.hpp>
+#endif
 
 using pg::Ray;
 using pg::Vec3;
@@ -24,128 +34,308 @@ typedef Volume::Node Node;
 Volume::Volume(float size, int depth) :
 	size(size),
 	depth(depth),
-	root(Vec3(0.0f, 0.0f, size*0.5f), 0.5f*size)
+	root(Vec3(0.0f, 0.0f, size*0.5f), 0.5f*size),
+	blockIndex(0),
+	blockOffset(0),
+	nodeCount(1)
 {
 
 }
 
+/** Memory allocated for nodes is not released. The blocks are reused. */
 void Volume::clear(float size, int depth)
 {
 	this->size = size;
 	this->depth = depth;
 	this->root = Node(Vec3(0.0f, 0.0f, size*0.5f), 0.5f*size);
-	if (this->root.getNode(0))
-		this->root.clear();
+	this->blockIndex = 0;
+	this->blockOffset = 0;
+	this->nodeCount = 1;
+}
+
+Node *Volume::allocate()
+{
+	if (this->blockOffset + 8 > PG_VOLUME_BLOCK_SIZE) {
+		this->blockIndex++;
+		this->blockOffset = 0;
+	}
+	if (this->blockIndex == this->blocks.size()) {
+		Node *block = new Node[PG_VOLUME_BLOCK_SIZE];
+		this->blocks.push_back(std::unique_ptr<Node[]>(block));
+	}
+	Node *nodes = &this->blocks[this->blockIndex][this->blockOffset];
+	this->blockOffset += 8;
+	this->nodeCount += 8;
+	return nodes;
+}
+
+void Volume::divide(Node *node)
+{
+	int index = this->nodeCount;
+	node->divide(allocate(), index);
+}
+
+int Volume::getDepth() const
+{
+	return this->depth;
+}
+
+size_t Volume::getNodeCount() const
+{
+	return this->nodeCount;
+}
+
+/** Returns the number of bytes reserved for nodes. */
+size_t Volume::getByteCount() const
+{
+	size_t count = this->blocks.size() * PG_VOLUME_BLOCK_SIZE;
+	return (count + 1) * sizeof(Node);
 }
 
 Node *Volume::addNode(Vec3 point, int depth)
 {
 	Node *node = getNode(point, &this->root);
 	while (node->getDepth() < this->depth && node->getDepth() < depth) {
-		node->divide();
+		divide(node);
 		node = getNode(point, node);
 	}
 	return node;
 }
 
 void Volume::addLine(Vec3 a, Vec3 b, float weight, float radius)
+{
+	addLine(a, b, weight, radius, nullptr);
+}
+
+void Volume::addLine(
+	Vec3 a, Vec3 b, float weight, float radius, std::vector<Node *> &nodes)
+{
+	addLine(a, b, weight, radius, &nodes);
+}
+
+void Volume::addLine(
+	Vec3 a, Vec3 b, float weight, float radius, std::vector<Node *> *nodes)
 {
 	float length = magnitude(b-a);
-	int depth = std::abs(std::log2(radius/this->size))-1;
+	int depth = getLineDepth(radius);
 	Node *firstNode = addNode(a, depth);
 	Node *lastNode = addNode(b, depth);
 	a = firstNode->getCenter();
 	b = lastNode->getCenter();
 	Ray ray(a, normalize(b-a));
 	Node *node = firstNode;
-	node->setDensity(weight);
+	setDensity(node, weight, nodes);
 
+	Traversal traversal(node, ray, depth);
 	while (node != lastNode) {
-		Node *nextNode = node->getAdjacentNode(ray, depth);
-		if (!nextNode || nextNode == node)
-			break;
-
 		Vec3 center = node->getCenter();
-		node = nextNode;
-		if (magnitude(a-center) > length)
+		node = traversal.next();
+		if (!node || magnitude(a-center) > length)
 			break;
+		while (node->getDepth() < this->depth && node->getDepth() < depth) {
+			divide(node);
+			node = traversal.descend();
+		}
+		setDensity(node, weight, nodes);
+	}
+}
+
+/** Nodes are not divided past the depth of the volume, so lines that are
+thinner than the deepest nodes share a depth. */
+int Volume::getLineDepth(float radius) const
+{
+	int depth = std::abs(std::log2(radius/this->size))-1;
+	return std::min(std::max(depth, 0), this->depth);
+}
+
+/** The number of lines that occupy a node are counted if the node is
+recorded so that the density is only removed with the last line. */
+void Volume::setDensity(Node *node, float density, std::vector<Node *> *nodes)
+{
+	node->setDensity(density);
+	if (nodes) {
+		node->lines++;
+		nodes->push_back(node);
+	}
+}
+
+void Volume::removeLine(const std::vector<Node *> &nodes)
+{
+	for (Node *node : nodes)
+		if (--node->lines == 0)
+			node->setDensity(0.0f);
+}
 
-		int d = node->getDepth();
-		while (d < this->depth && d < depth) {
-			node->divide();
-			node = node->getChildNode(center, depth);
-			d = node->getDepth();
+void Volume::clearFlux()
+{
+	this->root.direction = Vec3(0.0f, 0.0f, 0.0f);
+	this->root.quantity = 0;
+	size_t count = std::min(this->blocks.size(), this->blockIndex + 1);
+	for (size_t i = 0; i < count; i++) {
+		Node *block = this->blocks[i].get();
+		size_t size = PG_VOLUME_BLOCK_SIZE;
+		if (i == this->blockIndex)
+			size = this->blockOffset;
+		for (size_t j = 0; j < size; j++) {
+			block[j].direction = Vec3(0.0f, 0.0f, 0.0f);
+			block[j].quantity = 0;
 		}
-		node->setDensity(weight);
 	}
 }
 
-Node *Node::getAdjacentNode(Ray ray, int depth)
+/* Subtrees at this depth are reduced independently of each other. */
+const int reductionDepth = 2;
+
+/* Visit the nodes of a subtree one level at a time starting from the deepest
+level. The vector is reused to store the nodes of the subtree. */
+static void reduceSubtree(
+	Node *node, const std::function<void(Node *)> &function,
+	std::vector<Node *> &nodes)
 {
-	Vec3 d;
-	Plane plane;
-	plane.point = this->center;
-	if (ray.direction.x < 0.0f) {
-		plane.point.x -= this->size;
-		d.x = -1.0f;
-	} else {
-		plane.point.x += this->size;
-		d.x = 1.0f;
+	nodes.clear();
+	nodes.push_back(node);
+	for (size_t i = 0; i < nodes.size(); i++) {
+		if (nodes[i]->getNode(0))
+			for (int j = 0; j < 8; j++)
+				nodes.push_back(nodes[i]->getNode(j));
 	}
-	if (ray.direction.y < 0.0f) {
-		plane.point.y -= this->size;
-		d.y = -1.0f;
-	} else {
-		plane.point.y += this->size;
-		d.y = 1.0f;
+	for (size_t i = nodes.size(); i > 0; i--)
+		function(nodes[i-1]);
+}
+
+/** The function is called on every node after it is called on the children
+of the node. Subtrees are reduced on separate threads, so the function
+should only modify the node it is given and read its children. All
+available hardware threads are used if the number of threads is zero. */
+void Volume::reduce(const std::function<void(Node *)> &function, int threads)
+{
+	std::vector<Node *> top;
+	std::vector<Node *> subtrees;
+	top.push_back(&this->root);
+	for (size_t i = 0; i < top.size(); i++) {
+		if (!top[i]->getNode(0))
+			continue;
+		for (int j = 0; j < 8; j++) {
+			Node *child = top[i]->getNode(j);
+			if (child->getDepth() < reductionDepth)
+				top.push_back(child);
+			else
+				subtrees.push_back(child);
+		}
+	}
+
+	std::atomic<size_t> next(0);
+	auto reduce = [&] () {
+		std::vector<Node *> nodes;
+		size_t index;
+		while ((index = next++) < subtrees.size())
+			reduceSubtree(subtrees[index], function, nodes);
+	};
+	if (threads <= 0)
+		threads = std::thread::hardware_concurrency();
+	if (threads > static_cast<int>(subtrees.size()))
+		threads = subtrees.size();
+	std::vector<std::thread> workers;
+	for (int i = 1; i < threads; i++)
+		workers.emplace_back(reduce);
+	reduce();
+	for (std::thread &worker : workers)
+		worker.join();
+
+	for (size_t i = top.size(); i > 0; i--)
+		function(top[i-1]);
+}
+
+Volume::Traversal::Traversal(Node *node, Ray ray, int depth) :
+	origin{ray.origin.x, ray.origin.y, ray.origin.z},
+	direction{ray.direction.x, ray.direction.y, ray.direction.z},
+	point{ray.origin.x, ray.origin.y, ray.origin.z},
+	node(node),
+	depth(depth),
+	axis(-1)
+{
+	for (int i = 0; i < 3; i++)
+		this->inverse[i] = 1.0f / this->direction[i];
+	descend();
+}
+
+Node *Volume::Traversal::getNode()
+{
+	return this->node;
+}
+
+Node *Volume::Traversal::next()
+{
+	if (!this->node)
+		return nullptr;
+
+	Vec3 v = this->node->getCenter();
+	const float center[3] = {v.x, v.y, v.z};
+	float size = this->node->getSize();
+	float t = std::numeric_limits<float>::max();
+	this->axis = -1;
+	for (int i = 0; i < 3; i++) {
+		float s;
+		if (this->direction[i] > 0.0f)
+			s = center[i] + size - this->origin[i];
+		else if (this->direction[i] < 0.0f)
+			s = center[i] - size - this->origin[i];
+		else
+			continue;
+		s *= this->inverse[i];
+		if (s < t) {
+			t = s;
+			this->axis = i;
+		}
 	}
-	if (ray.direction.z < 0.0f) {
-		plane.point.z -= this->size;
-		d.z = -1.0f;
-	} else {
-		plane.point.z += this->size;
-		d.z = 1.0f;
+	if (this->axis < 0) {
+		this->node = nullptr;
+		return nullptr;
 	}
 
-	Node *node = this;
-	Vec3 p;
-	float t;
-
-	plane.normal = Vec3(d.x, 0.0f, 0.0f);
-	t = intersectsPlane(ray, plane);
-	p = t*ray.direction + ray.origin;
-	p.y -= 0.000001f;
-	p.z -= 0.000001f;
-	if (t && d.y*p.y < d.y*plane.point.y && d.z*p.z < d.z*plane.point.z)
-		node = node->getAdjacentNode(1, p, d.x > 0.0f, depth);
-
-	plane.normal = Vec3(0.0f, d.y, 0.0f);
-	t = intersectsPlane(ray, plane);
-	p = t*ray.direction + ray.origin;
-	p.x -= 0.000001f;
-	p.z -= 0.000001f;
-	if (t && d.x*p.x < d.x*plane.point.x && d.z*p.z < d.z*plane.point.z)
-		node = node->getAdjacentNode(2, p, d.y > 0.0f, depth);
-
-	plane.normal = Vec3(0.0f, 0.0f, d.z);
-	t = intersectsPlane(ray, plane);
-	p = t*ray.direction + ray.origin;
-	p.y -= 0.000001f;
-	p.x -= 0.000001f;
-	if (t && d.y*p.y < d.y*plane.point.y && d.x*p.x < d.x*plane.point.x)
-		node = node->getAdjacentNode(4, p, d.z > 0.0f, depth);
+	for (int i = 0; i < 3; i++)
+		this->point[i] = this->origin[i] + t*this->direction[i];
+	bool positive = this->direction[this->axis] > 0.0f;
+	this->node = getNeighbour(this->node, 1 << this->axis, positive);
+	return descend();
+}
 
+Node *Volume::Traversal::descend()
+{
+	Node *node = this->node;
+	while (node && node->getNode(0) && node->getDepth() < this->depth) {
+		Vec3 v = node->getCenter();
+		const float center[3] = {v.x, v.y, v.z};
+		int index = 0;
+		for (int i = 0; i < 3; i++) {
+			bool positive;
+			if (i == this->axis)
+				positive = this->direction[i] < 0.0f;
+			else
+				positive = this->point[i] >= center[i];
+			if (positive)
+				index |= 1 << i;
+		}
+		node = node->getNode(index);
+	}
+	this->node = node;
 	return node;
 }
 
-Node *Node::getAdjacentNode(int axis, Vec3 point, bool positive, int depth)
+/** Return the adjacent node at the same depth or a larger leaf node. The
+axis is a bit in the index of a child (x=1, y=2, z=4). */
+Node *Volume::Traversal::getNeighbour(Node *node, int axis, bool positive)
 {
-	if (!getParent())
-		return this;
-	else if (positive)
-		return getNextNode(axis, point, depth);
-	else
-		return getPreviousNode(axis, point, depth);
+	Node *parent = node->getParent();
+	if (!parent)
+		return nullptr;
+	int index = node - parent->getNode(0);
+	if (((index & axis) == 0) == positive)
+		return parent->getNode(index ^ axis);
+	Node *neighbour = getNeighbour(parent, axis, positive);
+	if (neighbour && neighbour->getNode(0))
+		return neighbour->getNode(index ^ axis);
+	return neighbour;
 }
 
 Node *Node::getNextNode(int axis, Vec3 point, int depth)
@@ -218,6 +408,17 @@ Node *Volume::getNode(Vec3 point)
 	return getNode(point, &this->root);
 }
 
+/** Nodes are allocated in order, so the index of a node is its position in
+the blocks after the root. */
+Node *Volume::getNode(size_t index)
+{
+	if (index == 0)
+		return &this->root;
+	index--;
+	size_t block = index / PG_VOLUME_BLOCK_SIZE;
+	return &this->blocks[block][index % PG_VOLUME_BLOCK_SIZE];
+}
+
 Node *Volume::getNode(Vec3 point, Node *node)
 {
 	Node *n = node;
@@ -235,12 +436,15 @@ Node *Volume::getNode(Vec3 point, Node *node)
 Node::Node(Vec3 center, float size) :
 	nodes(nullptr),
 	parent(nullptr),
+	index(0),
 	depth(0),
 	center(center),
 	size(size),
 	density(0.0f),
+	obstacle(0.0f),
 	direction(0.0f, 0.0f, 0.0f),
-	quantity(0)
+	quantity(0),
+	lines(0)
 {
 
 }
@@ -248,29 +452,26 @@ Node::Node(Vec3 center, float size) :
 Node::Node() :
 	nodes(nullptr),
 	parent(nullptr),
+	index(0),
 	depth(0),
 	density(0.0f),
+	obstacle(0.0f),
 	direction(0.0f, 0.0f, 0.0f),
-	quantity(0)
+	quantity(0),
+	lines(0)
 {
 
 }
 
-Node::~Node()
-{
-	if (this->nodes)
-		delete[] this->nodes;
-}
-
+/** Child nodes are detached but their memory is owned by the volume. */
 void Node::clear()
 {
 	this->density = 0.0f;
+	this->obstacle = 0.0f;
 	this->direction = Vec3(0.0f, 0.0f, 0.0f);
 	this->quantity = 0;
-	if (this->nodes) {
-		delete[] this->nodes;
-		this->nodes = nullptr;
-	}
+	this->lines = 0;
+	this->nodes = nullptr;
 }
 
 Vec3 Node::getCenter() const
@@ -283,6 +484,11 @@ float Node::getSize() const
 	return this->size;
 }
 
+int Node::getIndex() const
+{
+	return this->index;
+}
+
 int Node::getDepth() const
 {
 	return this->depth;
@@ -309,9 +515,9 @@ const Node *Node::getNode(int index) const
 		return nullptr;
 }
 
-void Node::divide()
+void Node::divide(Node *nodes, int index)
 {
-	this->nodes = new Node[8];
+	this->nodes = nodes;
 	for (int i = 0; i < 8; i++) {
 		Vec3 center = this->center;
 		float size = 0.5f * this->size;
@@ -331,8 +537,15 @@ void Node::divide()
 		this->nodes[i].size = size;
 		this->nodes[i].depth = this->depth + 1;
 		this->nodes[i].parent = this;
+		this->nodes[i].index = index + i;
 		this->nodes[i].nodes = nullptr;
+		this->nodes[i].density = 0.0f;
+		this->nodes[i].obstacle = this->obstacle;
+		this->nodes[i].direction = Vec3(0.0f, 0.0f, 0.0f);
+		this->nodes[i].quantity = 0;
+		this->nodes[i].lines = 0;
 	}
+	this->obstacle = 0.0f;
 }
 
 void Node::setDensity(float density)
@@ -342,7 +555,17 @@ void Node::setDensity(float density)
 
 float Node::getDensity() const
 {
-	return this->density;
+	return std::max(this->density, this->obstacle);
+}
+
+void Node::setObstacleDensity(float density)
+{
+	this->obstacle = density;
+}
+
+float Node::getObstacleDensity() const
+{
+	return this->obstacle;
 }
 
 void Node::setDirection(Vec3 direction)
@@ -364,3 +587,63 @@ int Node::getQuantity() const
 {
 	return this->quantity;
 }
+
+#ifdef PG_SERIALIZE
+template<class Archive>
+void Volume::serialize(Archive &ar, const unsigned version)
+{
+	boost::serialization::split_member(ar, *this, version);
+}
+
+template<class Archive>
+void Volume::save(Archive &ar, const unsigned) const
+{
+	ar & this->size;
+	ar & this->depth;
+	saveNode(ar, &this->root);
+}
+
+template<class Archive>
+void Volume::load(Archive &ar, const unsigned)
+{
+	float size;
+	int depth;
+	ar & size;
+	ar & depth;
+	clear(size, depth);
+	loadNode(ar, &this->root);
+}
+
+template<class Archive>
+void Volume::saveNode(Archive &ar, const Node *node) const
+{
+	bool divided = node->nodes != nullptr;
+	ar & divided;
+	ar & node->density;
+	ar & node->obstacle;
+	ar & node->direction;
+	ar & node->quantity;
+	ar & node->lines;
+	for (int i = 0; divided && i < 8; i++)
+		saveNode(ar, &node->nodes[i]);
+}
+
+template<class Archive>
+void Volume::loadNode(Archive &ar, Node *node)
+{
+	bool divided;
+	ar & divided;
+	ar & node->density;
+	ar & node->obstacle;
+	ar & node->direction;
+	ar & node->quantity;
+	ar & node->lines;
+	if (divided)
+		divide(node);
+	for (int i = 0; divided && i < 8; i++)
+		loadNode(ar, &node->nodes[i]);
+}
+
+template void Volume::serialize(boost::archive::text_oarchive &, unsigned);
+template void Volume::serialize(boost::archive::text_iarchive &, unsigned);
+#endif
@@ -18,6 +18,11 @@
 
 #include "math/intersection.h"
 #include "math/vec3.h"
+#include <functional>
+#include <memory>
+#include <vector>
+
+#define PG_VOLUME_BLOCK_SIZE 4096
 
 namespace pg {
 	class Volume {
@@ -25,19 +30,23 @@ namespace pg {
 		class Node {
 			Node *nodes;
 			Node *parent;
+			int index;
 			int depth;
 			Vec3 center;
 			float size;
 
 			float density;
+			float obstacle;
 			Vec3 direction;
 			int quantity;
+			int lines;
 
 			Node();
-			Node *getAdjacentNode(int, Vec3, bool, int);
+			void divide(Node *nodes, int index);
+
+			friend class Volume;
 
 		public:
-			~Node();
 			Node(Vec3 center, float size);
 			Node *getParent();
 			Node *getNode(int index);
@@ -45,35 +54,115 @@ namespace pg {
 			Node *getNextNode(int axis, Vec3 point, int depth);
 			Node *getPreviousNode(int axis, Vec3 point, int depth);
 			Node *getChildNode(Vec3 point, int depth);
-			Node *getAdjacentNode(Ray ray, int depth = 1000);
 			Vec3 getCenter() const;
 			float getSize() const;
+			/** Nodes are numbered in the order that they are
+			added, starting with zero for the root. */
+			int getIndex() const;
 			int getDepth() const;
-			void divide();
 			void clear();
 
 			void setDensity(float density);
+			/** Returns the larger of the density of the lines and
+			the density of the obstacles in the node. */
 			float getDensity() const;
+			/** Obstacle density is kept separate so that removing
+			a line does not remove the obstacle behind it. */
+			void setObstacleDensity(float density);
+			float getObstacleDensity() const;
 			void setDirection(Vec3 direction);
 			Vec3 getDirection() const;
 			void setQuantity(int quantity);
 			int getQuantity() const;
 		};
 
+		/** Visits the leaf nodes along a ray in order without
+		floating point offsets. The node that is entered next is found
+		through the face that the ray leaves the current node
+		through. */
+		class Traversal {
+			float origin[3];
+			float direction[3];
+			float inverse[3];
+			float point[3];
+			Node *node;
+			int depth;
+			int axis;
+
+			Node *getNeighbour(Node *node, int axis, bool positive);
+
+		public:
+			Traversal(Node *node, Ray ray, int depth = 1000);
+			Node *getNode();
+			/** Returns null once the ray leaves the volume. */
+			Node *next();
+			/** Descend into the children of the current node. */
+			Node *descend();
+		};
+
 		Volume(float size = 1.0f, int depth = 1);
+		Volume(const Volume &) = delete;
+		Volume &operator=(const Volume &) = delete;
 		void clear(float size, int depth);
+		void divide(Node *node);
 		Node *addNode(Vec3 point, int depth = 1000);
 		void addLine(Vec3 a, Vec3 b, float weight, float radius);
+		/** Nodes occupied by the line are appended to the vector. */
+		void addLine(
+			Vec3 a, Vec3 b, float weight, float radius,
+			std::vector<Node *> &nodes);
+		/** Return the depth of the nodes that a line of a radius
+		occupies. */
+		int getLineDepth(float radius) const;
+		/** Remove a line using the nodes returned by addLine. */
+		void removeLine(const std::vector<Node *> &nodes);
+		/** Reset the direction and quantity of every node. */
+		void clearFlux();
+		/** Compute per-node statistics from the leaves to the root. */
+		void reduce(
+			const std::function<void(Node *)> &function,
+			int threads = 1);
 		Node *getNode(Vec3 point);
+		/** Return the node of an index below getNodeCount(). */
+		Node *getNode(size_t index);
 		Node *getRoot();
 		const Node *getRoot() const;
+		int getDepth() const;
+		size_t getNodeCount() const;
+		size_t getByteCount() const;
 
 	private:
 		float size;
 		int depth;
 		Node root;
+		/* Nodes are allocated in groups of eight from fixed size
+		blocks. The blocks are kept when the volume is cleared so that
+		the memory can be reused by the next iteration. */
+		std::vector<std::unique_ptr<Node[]>> blocks;
+		size_t blockIndex;
+		size_t blockOffset;
+		size_t nodeCount;
 
+		Node *allocate();
 		Node *getNode(Vec3 point, Node *node);
+		void addLine(Vec3, Vec3, float, float, std::vector<Node *> *);
+		void setDensity(Node *, float, std::vector<Node *> *);
+
+#ifdef PG_SERIALIZE
+		/* The definitions are instantiated for text archives in
+		volume.cpp. */
+		friend class boost::serialization::access;
+		template<class Archive>
+		void serialize(Archive &, const unsigned);
+		template<class Archive>
+		void save(Archive &, const unsigned) const;
+		template<class Archive>
+		void load(Archive &, const unsigned);
+		template<class Archive>
+		void saveNode(Archive &, const Node *) const;
+		template<class Archive>
+		void loadNode(Archive &, Node *);
+#endif
 	};
 }
 
@@ -104,6 +104,32 @@ BOOST_AUTO_TEST_CASE(test_generate)
 	compareAllocations(plant.getRoot(), initialAllocations);
 }
 
+BOOST_AUTO_TEST_CASE(test_generate_node)
+{
+	Plant plant;
+	plant.setDefault();
+	ParameterTree ptree;
+	initializeParameterTree(ptree);
+
+	PatternGenerator generator(&plant);
+	generator.setParameterTree(ptree);
+	generator.grow();
+
+	vector<Stem *> initialAllocations;
+	addAllocations(plant.getRoot(), initialAllocations);
+
+	Selection selection(&plant);
+	selection.addStem(plant.getRoot());
+
+	Generate generate(&selection, &generator);
+	generate.execute();
+	ptree.updateField([] (StemData *data) {data->density = 2.0f;}, "1.1");
+	plant.getRoot()->setParameterTree(ptree);
+	generate.execute("1.1");
+	generate.undo();
+	compareAllocations(plant.getRoot(), initialAllocations);
+}
+
 BOOST_AUTO_TEST_CASE(test_add_remove)
 {
 	Plant plant;
@@ -0,0 +1,595 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include "../plant_generator/generator.h"
+#include "../plant_generator/pattern_generator.h"
+#include "../plant_generator/stand_generator.h"
+#include <boost/archive/text_iarchive.hpp>
+#include <boost/archive/text_oarchive.hpp>
+#include <functional>
+#include <numeric>
+#include <sstream>
+
+using namespace pg;
+namespace bt = boost::unit_test;
+
+bool compareStems(const Stem *a, const Stem *b)
+{
+	if (!a || !b)
+		return a == b;
+	if (*a != *b)
+		return false;
+	const Stem *childA = a->getChild();
+	const Stem *childB = b->getChild();
+	while (childA && childB) {
+		if (!compareStems(childA, childB))
+			return false;
+		childA = childA->getSibling();
+		childB = childB->getSibling();
+	}
+	return childA == childB;
+}
+
+bool compareNodes(const Volume::Node *a, const Volume::Node *b)
+{
+	if (a->getDensity() != b->getDensity())
+		return false;
+	if (a->getQuantity() != b->getQuantity())
+		return false;
+	if (a->getDirection() != b->getDirection())
+		return false;
+	if (!a->getNode(0) || !b->getNode(0))
+		return a->getNode(0) == b->getNode(0);
+	for (int i = 0; i < 8; i++)
+		if (!compareNodes(a->getNode(i), b->getNode(i)))
+			return false;
+	return true;
+}
+
+void setGenerator(Generator &generator)
+{
+	generator.cycles = 3;
+	generator.nodes = 3;
+	generator.rays = 2000;
+	generator.seed = 2;
+}
+
+/* Grow a plant with one thread and with three threads after a function
+sets the parameters of the generators. Returns true if the plant grew and
+if the plants and the light in their volumes are the same. */
+bool compareThreads(const std::function<void(Generator &)> &set)
+{
+	Plant plant1;
+	plant1.setDefault();
+	Generator generator1(&plant1);
+	setGenerator(generator1);
+	set(generator1);
+	generator1.threads = 1;
+	generator1.grow();
+
+	Plant plant2;
+	plant2.setDefault();
+	Generator generator2(&plant2);
+	setGenerator(generator2);
+	set(generator2);
+	generator2.threads = 3;
+	generator2.grow();
+
+	const Volume *volume1 = generator1.getVolume();
+	const Volume *volume2 = generator2.getVolume();
+	return plant1.getRoot()->getPath().getSize() > 2 &&
+		compareStems(plant1.getRoot(), plant2.getRoot()) &&
+		compareNodes(volume1->getRoot(), volume2->getRoot()) &&
+		generator1.getRayCounts() == generator2.getRayCounts();
+}
+
+/* Grow a plant for five cycles and compare it to a plant that is resumed
+after being saved at the third cycle. Stems are pruned, so the volume of
+an incremental run differs from a rebuilt volume. */
+bool resume(bool incremental)
+{
+	Plant plant1;
+	plant1.setDefault();
+	Generator generator1(&plant1);
+	setGenerator(generator1);
+	generator1.cycles = 5;
+	generator1.synthesisThreshold = 0.9f;
+	generator1.incremental = incremental;
+	generator1.grow();
+
+	std::stringstream stream;
+	{
+		Plant plant;
+		plant.setDefault();
+		Generator generator(&plant);
+		setGenerator(generator);
+		generator.cycles = 3;
+		generator.synthesisThreshold = 0.9f;
+		generator.incremental = incremental;
+		generator.grow();
+		boost::archive::text_oarchive oa(stream);
+		oa << generator;
+	}
+
+	Plant plant2;
+	Generator generator2(&plant2);
+	setGenerator(generator2);
+	generator2.synthesisThreshold = 0.9f;
+	generator2.incremental = incremental;
+	boost::archive::text_iarchive ia(stream);
+	ia >> generator2;
+	if (generator2.getCycle() != 3)
+		return false;
+	generator2.cycles = 5;
+	generator2.resume();
+	return generator2.getCycle() == 5 &&
+		compareStems(plant1.getRoot(), plant2.getRoot()) &&
+		compareNodes(generator1.getVolume()->getRoot(),
+			generator2.getVolume()->getRoot());
+}
+
+void setParameterTree(PatternGenerator &generator, unsigned seed)
+{
+	ParameterTree tree;
+	ParameterNode *root = tree.createRoot();
+	StemData data = root->getData();
+	data.seed = seed;
+	root->setData(data);
+	data.density = 2.0f;
+	data.densityCurve.setDefault(1);
+	data.distance = 30.0f;
+	data.length = 40.0f;
+	data.radiusThreshold = 0.005f;
+	data.fork = 0.1f;
+	data.leaf.density = 3.0f;
+	data.leaf.densityCurve.setDefault(1);
+	tree.addChild("")->setData(data);
+	data.angleVariation = 0.2f;
+	tree.addChild("1")->setData(data);
+	generator.setParameterTree(tree);
+}
+
+size_t countStems(const Stem *stem)
+{
+	size_t count = 1;
+	for (const Stem *c = stem->getChild(); c; c = c->getSibling())
+		count += countStems(c);
+	return count;
+}
+
+BOOST_AUTO_TEST_SUITE(generator)
+
+BOOST_AUTO_TEST_CASE(test_pattern_thread_count)
+{
+	Plant plant1;
+	plant1.setDefault();
+	PatternGenerator generator1(&plant1);
+	setParameterTree(generator1, 3);
+	generator1.threads = 1;
+	generator1.grow();
+
+	Plant plant2;
+	plant2.setDefault();
+	PatternGenerator generator2(&plant2);
+	setParameterTree(generator2, 3);
+	generator2.threads = 4;
+	generator2.grow();
+	generator2.grow();
+
+	BOOST_TEST(countStems(plant1.getRoot()) > 20);
+	BOOST_TEST(compareStems(plant1.getRoot(), plant2.getRoot()));
+
+	/* The random streams of the stems are derived from the seed. */
+	setParameterTree(generator2, 4);
+	generator2.grow();
+	BOOST_TEST(!compareStems(plant1.getRoot(), plant2.getRoot()));
+	setParameterTree(generator2, 3);
+	generator2.threads = 0;
+	generator2.grow();
+	BOOST_TEST(compareStems(plant1.getRoot(), plant2.getRoot()));
+}
+
+BOOST_AUTO_TEST_CASE(test_pattern_node)
+{
+	Plant plant1;
+	plant1.setDefault();
+	PatternGenerator generator1(&plant1);
+	setParameterTree(generator1, 4);
+	generator1.grow();
+
+	ParameterTree tree = generator1.getParameterTree();
+	tree.updateField([] (StemData *data) {data->density = 1.0f;}, "1.1");
+	plant1.getRoot()->setParameterTree(tree);
+	BOOST_TEST(generator1.grow(plant1.getRoot(), "1.1"));
+	tree.updateField([] (StemData *data) {data->leaf.density = 1.0f;}, "1");
+	plant1.getRoot()->setParameterTree(tree);
+	BOOST_TEST(generator1.grow(plant1.getRoot(), "1"));
+
+	Plant plant2;
+	plant2.setDefault();
+	PatternGenerator generator2(&plant2);
+	generator2.setParameterTree(tree);
+	generator2.grow();
+
+	BOOST_TEST(compareStems(plant1.getRoot(), plant2.getRoot()));
+	tree.addChild("1.1");
+	plant1.getRoot()->setParameterTree(tree);
+	BOOST_TEST(!generator1.grow(plant1.getRoot(), "1.1"));
+}
+
+BOOST_AUTO_TEST_CASE(test_pattern_forget)
+{
+	Plant plant;
+	plant.setDefault();
+	PatternGenerator generator(&plant);
+	setParameterTree(generator, 4);
+	generator.grow();
+
+	Stem *root = plant.getRoot();
+	Stem *child = root->getChild();
+	generator.forget(child);
+	plant.deleteStem(child);
+	BOOST_TEST(generator.grow(root, "1.1"));
+	generator.forget(root);
+	BOOST_TEST(!generator.grow(root, "1.1"));
+}
+
+BOOST_AUTO_TEST_CASE(test_thread_count)
+{
+	BOOST_TEST(compareThreads([] (Generator &) {}));
+}
+
+BOOST_AUTO_TEST_CASE(test_sky)
+{
+	BOOST_TEST(compareThreads([] (Generator &generator) {
+		generator.skyDivisions = 4;
+	}));
+
+	Plant plant;
+	plant.setDefault();
+	Generator generator(&plant);
+	setGenerator(generator);
+	generator.skyDivisions = 4;
+	generator.grow();
+
+	/* Light in an open node arrives from the bins in proportion to their
+	weights, so its direction is the weighted average of the bins. */
+	Sky sky(generator.skyDivisions);
+	float z = 0.0f;
+	for (int i = 0; i < sky.getBinCount(); i++)
+		z += sky.getWeight(i) * sky.getDirection(i, 0.5f, 0.5f).z;
+	const Volume::Node *node = generator.getVolume()->getRoot()->getNode(7);
+	BOOST_TEST(std::abs(node->getDirection().z - z) < 0.03f);
+}
+
+/* Each leaf node receives a single ray. Returns the least amount of light
+received by a leaf, or -1 if a leaf received more than one ray. */
+float getShade(const Volume::Node *node)
+{
+	if (!node->getNode(0)) {
+		if (node->getQuantity() != 1)
+			return -1.0f;
+		return magnitude(node->getDirection());
+	}
+	float shade = 1.0f;
+	for (int i = 0; i < 8; i++)
+		shade = std::min(shade, getShade(node->getNode(i)));
+	return shade;
+}
+
+BOOST_AUTO_TEST_CASE(test_shadow_propagation)
+{
+	BOOST_TEST(compareThreads([] (Generator &generator) {
+		generator.lightModel = Generator::ShadowPropagation;
+	}));
+
+	Plant plant;
+	plant.setDefault();
+	Generator generator(&plant);
+	setGenerator(generator);
+	generator.lightModel = Generator::ShadowPropagation;
+	generator.grow();
+	float shade = getShade(generator.getVolume()->getRoot());
+	BOOST_TEST(shade >= 0.0f);
+	BOOST_TEST(shade < 0.5f);
+}
+
+BOOST_AUTO_TEST_CASE(test_pruning)
+{
+	Plant plant;
+	plant.setDefault();
+	Generator generator(&plant);
+	setGenerator(generator);
+	generator.cycles = 4;
+	generator.synthesisThreshold = 0.9f;
+	generator.grow();
+
+	Generator::Pruning pruning = generator.getPruning();
+	StemPool *pool = plant.getStemPool();
+	BOOST_TEST(pruning.stemsBefore > pruning.stemsAfter);
+	BOOST_TEST(pruning.poolsAfter <= pruning.poolsBefore);
+	BOOST_TEST(pool->getPoolCount() == pruning.poolsAfter);
+	/* Stems are added after the last cycle is pruned. */
+	BOOST_TEST(pool->getStemCount() >= pruning.stemsAfter);
+}
+
+/* The density of a parent node is the average density of its children. */
+bool isGeneralized(const Volume::Node *node)
+{
+	if (!node->getNode(0))
+		return true;
+	float density = 0.0f;
+	for (int i = 0; i < 8; i++) {
+		if (!isGeneralized(node->getNode(i)))
+			return false;
+		density += node->getNode(i)->getDensity();
+	}
+	return std::abs(density / 8.0f - node->getDensity()) < 0.00001f;
+}
+
+BOOST_AUTO_TEST_CASE(test_incremental_density)
+{
+	Plant plant;
+	plant.setDefault();
+	Generator generator(&plant);
+	setGenerator(generator);
+	generator.incremental = true;
+	generator.synthesisThreshold = 0.9f;
+	generator.grow();
+	/* The nodes added in the last cycle are added to the volume without
+	rebuilding it. */
+	generator.updateFlux();
+	const Volume::Node *root = generator.getVolume()->getRoot();
+	BOOST_TEST(root->getDensity() > 0.0f);
+	BOOST_TEST(isGeneralized(root));
+}
+
+/* Add the segments of a stem and its descendants to a volume at their
+current radii. */
+void addSegments(Volume *volume, const Plant *plant, const Stem *stem)
+{
+	const Path &path = stem->getPath();
+	Vec3 location = stem->getLocation();
+	std::vector<float> radii(path.getSize());
+	plant->getRadii(stem, 0, path.getSize(), radii.data());
+	for (size_t i = 1; i < path.getSize(); i++) {
+		Vec3 a = location + path.get(i-1);
+		Vec3 b = location + path.get(i);
+		volume->addLine(a, b, 1.0f, radii[i]);
+	}
+	for (const Stem *c = stem->getChild(); c; c = c->getSibling())
+		addSegments(volume, plant, c);
+}
+
+/* Returns true if every leaf below a node has a density. */
+bool hasDensity(const Volume::Node *node, float density)
+{
+	if (!node->getNode(0))
+		return node->getDensity() == density;
+	for (int i = 0; i < 8; i++)
+		if (!hasDensity(node->getNode(i), density))
+			return false;
+	return true;
+}
+
+/* Returns true if the leaves of the volumes have the same density at every
+point. The first volume can be divided further, since nodes of pruned stems
+are not merged. */
+bool compareLeaves(const Volume::Node *a, const Volume::Node *b)
+{
+	if (!b->getNode(0))
+		return hasDensity(a, b->getDensity());
+	if (!a->getNode(0))
+		return false;
+	for (int i = 0; i < 8; i++)
+		if (!compareLeaves(a->getNode(i), b->getNode(i)))
+			return false;
+	return true;
+}
+
+BOOST_AUTO_TEST_CASE(test_incremental_volume)
+{
+	Plant plant;
+	plant.setDefault();
+	Generator generator(&plant);
+	setGenerator(generator);
+	generator.cycles = 5;
+	generator.secondaryGrowthRate = 0.05f;
+	generator.incremental = true;
+	generator.grow();
+	generator.updateFlux();
+
+	/* Stems grow thick enough for their first segments to occupy
+	larger nodes than they were added with. */
+	const Volume *volume = generator.getVolume();
+	Volume rebuilt(2.0f * volume->getRoot()->getSize(), volume->getDepth());
+	addSegments(&rebuilt, &plant, plant.getRoot());
+	BOOST_TEST(compareLeaves(volume->getRoot(), rebuilt.getRoot()));
+}
+
+/* Return the number of rays cast in each cycle with a ray tolerance. */
+std::vector<int> getRayCounts(float tolerance)
+{
+	Plant plant;
+	plant.setDefault();
+	Generator generator(&plant);
+	setGenerator(generator);
+	generator.rays = 20000;
+	generator.rayTolerance = tolerance;
+	generator.grow();
+	return generator.getRayCounts();
+}
+
+BOOST_AUTO_TEST_CASE(test_adaptive_rays)
+{
+	BOOST_TEST(compareThreads([] (Generator &generator) {
+		generator.rays = 20000;
+		generator.rayTolerance = 0.03f;
+	}));
+
+	std::vector<int> counts = getRayCounts(0.03f);
+	BOOST_TEST(counts.size() == 9);
+	BOOST_TEST(counts.front() < 20000);
+	for (int count : counts)
+		BOOST_TEST(count <= 20000);
+
+	/* A looser tolerance stops casting rays sooner. */
+	std::vector<int> looseCounts = getRayCounts(0.1f);
+	int total = std::accumulate(counts.begin(), counts.end(), 0);
+	int looseTotal = std::accumulate(
+		looseCounts.begin(), looseCounts.end(), 0);
+	BOOST_TEST(looseTotal < total);
+}
+
+BOOST_AUTO_TEST_CASE(test_resume)
+{
+	BOOST_TEST(resume(false));
+	BOOST_TEST(resume(true));
+}
+
+/* Record four cycles and compare the plants of the player to the plants of
+a generator after two and four cycles. */
+void checkTimeLapse(size_t keyInterval)
+{
+	Plant plant1;
+	plant1.setDefault();
+	Generator generator1(&plant1);
+	setGenerator(generator1);
+	generator1.cycles = 4;
+	generator1.synthesisThreshold = 0.9f;
+	TimeLapse timeLapse;
+	timeLapse.keyInterval = keyInterval;
+	generator1.timeLapse = &timeLapse;
+	generator1.grow();
+
+	Plant plant2;
+	plant2.setDefault();
+	Generator generator2(&plant2);
+	setGenerator(generator2);
+	generator2.cycles = 2;
+	generator2.synthesisThreshold = 0.9f;
+	generator2.grow();
+
+	Plant plant3;
+	TimeLapsePlayer player(&timeLapse, &plant3);
+	BOOST_TEST(timeLapse.getStepCount() == 4);
+	player.setStep(3);
+	BOOST_TEST(compareStems(plant1.getRoot(), plant3.getRoot()));
+	player.setStep(1);
+	BOOST_TEST(player.getStepCount() == 2);
+	BOOST_TEST(compareStems(plant2.getRoot(), plant3.getRoot()));
+	player.setStep(3);
+	BOOST_TEST(compareStems(plant1.getRoot(), plant3.getRoot()));
+	player.setStep(2);
+	player.setStep(0);
+	player.setStep(3);
+	BOOST_TEST(compareStems(plant1.getRoot(), plant3.getRoot()));
+}
+
+BOOST_AUTO_TEST_CASE(test_time_lapse)
+{
+	checkTimeLapse(0);
+	checkTimeLapse(1);
+	checkTimeLapse(3);
+}
+
+BOOST_AUTO_TEST_CASE(test_time_lapse_keys)
+{
+	Plant plant;
+	TimeLapse timeLapse;
+	timeLapse.keyInterval = 3;
+	for (int i = 0; i < 7; i++)
+		timeLapse.record(&plant);
+	BOOST_TEST(!timeLapse.getKey(1));
+	BOOST_TEST(timeLapse.getKey(2)->step == 2);
+	BOOST_TEST(timeLapse.getKey(4)->step == 2);
+	BOOST_TEST(timeLapse.getKey(5)->step == 5);
+	BOOST_TEST(timeLapse.getKey(9)->step == 5);
+}
+
+/* A stem that is removed and reallocated at the same address with the same
+parent and distance is a new stem. */
+BOOST_AUTO_TEST_CASE(test_time_lapse_reuse)
+{
+	Plant plant;
+	Stem *root = plant.createRoot();
+	Stem *stem1 = plant.addStem(root);
+	stem1->setDistance(1.0f);
+	TimeLapse timeLapse;
+	timeLapse.record(&plant);
+	plant.deleteStem(stem1);
+	Stem *stem2 = plant.addStem(root);
+	stem2->setDistance(1.0f);
+	timeLapse.record(&plant);
+
+	const TimeLapse::Step &step = timeLapse.getStep(1);
+	BOOST_TEST(stem1 == stem2);
+	BOOST_TEST(step.removals.size() == 1);
+	BOOST_TEST(step.additions.size() == 1);
+}
+
+BOOST_AUTO_TEST_CASE(test_time_lapse_nodes)
+{
+	Plant plant1;
+	plant1.setDefault();
+	Generator generator1(&plant1);
+	setGenerator(generator1);
+	TimeLapse timeLapse(TimeLapse::Node);
+	generator1.timeLapse = &timeLapse;
+	generator1.grow();
+
+	Plant plant2;
+	TimeLapsePlayer player(&timeLapse, &plant2);
+	BOOST_TEST(timeLapse.getStepCount() == 9);
+	player.setStep(8);
+	BOOST_TEST(compareStems(plant1.getRoot(), plant2.getRoot()));
+}
+
+BOOST_AUTO_TEST_CASE(test_stand)
+{
+	Plant plants[2][3];
+	for (int i = 0; i < 2; i++) {
+		StandGenerator stand;
+		stand.cycles = 3;
+		stand.nodes = 3;
+		stand.light.rays = 2000;
+		stand.light.threads = i == 0 ? 1 : 3;
+		for (int j = 0; j < 3; j++) {
+			plants[i][j].setDefault();
+			Vec3 location(2.0f*j - 2.0f, 0.0f, 0.0f);
+			Plant *plant = &plants[i][j];
+			stand.addPlant(plant, location)->seed = j;
+		}
+		stand.grow();
+	}
+
+	for (int j = 0; j < 3; j++) {
+		BOOST_TEST(plants[0][j].getRoot()->getPath().getSize() > 2);
+		BOOST_TEST(compareStems(
+			plants[0][j].getRoot(), plants[1][j].getRoot()));
+	}
+}
+
+/* A plant that grows next to a neighbour receives less light than a plant
+that grows alone, so it grows differently. */
+BOOST_AUTO_TEST_CASE(test_stand_shade)
+{
+	Plant plants[3];
+	for (int i = 0; i < 2; i++) {
+		StandGenerator stand;
+		stand.cycles = 3;
+		stand.nodes = 3;
+		stand.light.rays = 2000;
+		for (int j = 0; j <= i; j++) {
+			plants[i+j].setDefault();
+			Vec3 location(0.5f*j, 0.0f, 0.0f);
+			stand.addPlant(&plants[i+j], location)->seed = 0;
+		}
+		stand.grow();
+	}
+
+	BOOST_TEST(plants[0].getRoot()->getPath().getSize() > 2);
+	BOOST_TEST(!compareStems(plants[0].getRoot(), plants[1].getRoot()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -2,8 +2,10 @@
 #include <boost/test/unit_test.hpp>
 
 #include "../plant_generator/math/vec3.h"
+#include "../plant_generator/math/curve.h"
 #include "../plant_generator/math/quat.h"
 #include "../plant_generator/math/intersection.h"
+#include "../plant_generator/math/sampler.h"
 #include "../plant_generator/geometry.h"
 
 const float pi = 3.14159265359f;
@@ -91,3 +93,95 @@ BOOST_AUTO_TEST_CASE(test_clamp_direction, *bt::tolerance(tolerance))
 }
 
 BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(samplers)
+
+/* Each interval of a dimension should contain one sample. */
+void testIntervals(Sampler::Type type, int dimension)
+{
+	const int size = 16;
+	Sampler sampler(type, size, 3);
+	std::vector<int> intervals(size, 0);
+	for (int i = 0; i < size; i++) {
+		float sample[PG_SAMPLER_DIMENSIONS];
+		sampler.getSample(i, sample);
+		for (int j = 0; j < PG_SAMPLER_DIMENSIONS; j++) {
+			BOOST_TEST(sample[j] >= 0.0f);
+			BOOST_TEST(sample[j] < 1.0f);
+		}
+		intervals[static_cast<int>(sample[dimension]*size)]++;
+	}
+	for (int count : intervals)
+		BOOST_TEST(count == 1);
+}
+
+BOOST_AUTO_TEST_CASE(test_sobol_intervals)
+{
+	for (int i = 0; i < PG_SAMPLER_DIMENSIONS; i++)
+		testIntervals(Sampler::Sobol, i);
+}
+
+BOOST_AUTO_TEST_CASE(test_stratified_cells)
+{
+	const int size = 16;
+	Sampler sampler(Sampler::Stratified, size, 3);
+	std::vector<int> origins(size, 0);
+	std::vector<int> directions(size, 0);
+	for (int i = 0; i < size; i++) {
+		float s[PG_SAMPLER_DIMENSIONS];
+		sampler.getSample(i, s);
+		int cells[4];
+		for (int j = 0; j < 4; j++)
+			cells[j] = static_cast<int>(s[j]*4);
+		origins[cells[0] + 4*cells[1]]++;
+		directions[cells[2] + 4*cells[3]]++;
+	}
+	for (int i = 0; i < size; i++) {
+		BOOST_TEST(origins[i] == 1);
+		BOOST_TEST(directions[i] == 1);
+	}
+}
+
+/* The origins of the first samples should not be limited to the first rows
+of the grid. */
+BOOST_AUTO_TEST_CASE(test_stratified_prefix)
+{
+	const int size = 1024;
+	Sampler sampler(Sampler::Stratified, size, 3);
+	int columns[4] = {};
+	int rows[4] = {};
+	for (int i = 0; i < size / 16; i++) {
+		float s[PG_SAMPLER_DIMENSIONS];
+		sampler.getSample(i, s);
+		columns[static_cast<int>(s[0]*4)]++;
+		rows[static_cast<int>(s[1]*4)]++;
+	}
+	for (int i = 0; i < 4; i++) {
+		BOOST_TEST(columns[i] > 0);
+		BOOST_TEST(rows[i] > 0);
+	}
+}
+
+/* Forward differences accumulate rounding errors but should stay close to
+the points that are evaluated directly. */
+BOOST_AUTO_TEST_CASE(test_bezier_steps)
+{
+	const Vec3 points[5] = {
+		Vec3(0.0f, 0.0f, 0.0f), Vec3(1.0f, 2.0f, 0.0f),
+		Vec3(3.0f, -1.0f, 2.0f), Vec3(4.0f, 0.5f, 1.0f),
+		Vec3(6.0f, 1.0f, -2.0f)};
+	const int count = 64;
+	const float delta = 1.0f / (count - 1);
+	for (int size = 1; size <= 5; size++) {
+		Vec3 result[count];
+		getBezier(points, size, 0.0f, delta, count, result);
+		for (int i = 0; i < count; i++) {
+			Vec3 point = getBezier(delta * i, points, size);
+			BOOST_TEST(magnitude(result[i] - point) < 0.0001f);
+		}
+	}
+	Vec3 point = getQuadraticBezier(0.3f, points[0], points[1], points[2]);
+	BOOST_TEST(magnitude(getBezier(0.3f, points, 3) - point) < tolerance);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -56,4 +56,43 @@ BOOST_AUTO_TEST_CASE(test_index_bounds)
 	BOOST_TEST(zeroCount < 3);
 }
 
+size_t getVertexCount(float tolerance)
+{
+	Plant plant;
+	plant.setDefault();
+	Stem *root = plant.createRoot();
+	Path path;
+	Spline spline;
+	spline.setDegree(3);
+	spline.addControl(Vec3(0.0f, 0.0f, 0.0f));
+	spline.addControl(Vec3(0.0f, 0.0f, 1.0f));
+	spline.addControl(Vec3(0.0f, 0.0f, 2.0f));
+	spline.addControl(Vec3(0.0f, 0.0f, 3.0f));
+	spline.addControl(Vec3(0.0f, 0.0f, 4.0f));
+	spline.addControl(Vec3(0.0f, 0.0f, 5.0f));
+	spline.addControl(Vec3(0.0f, 0.0f, 6.0f));
+	spline.addControl(Vec3(0.0f, 1.0f, 7.0f));
+	spline.addControl(Vec3(0.0f, 3.0f, 7.0f));
+	spline.addControl(Vec3(0.0f, 4.0f, 6.0f));
+	path.setSpline(spline);
+	path.setDivisions(8);
+	path.setInitialDivisions(8);
+	path.subdivide(tolerance);
+	root->setPath(path);
+	root->setMaxRadius(0.5f);
+
+	Mesh mesh(&plant);
+	mesh.generate();
+	return mesh.getVertexCount();
+}
+
+BOOST_AUTO_TEST_CASE(test_path_tolerance)
+{
+	/* Only the straight curve is sampled with fewer points. */
+	size_t uniform = getVertexCount(0.0f);
+	size_t adaptive = getVertexCount(0.0001f);
+	BOOST_TEST(adaptive < uniform);
+	BOOST_TEST(getVertexCount(0.1f) < adaptive);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,170 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include "../plant_generator/generator.h"
+#include "../plant_generator/obstacles.h"
+#include <cstdio>
+
+using namespace pg;
+namespace bt = boost::unit_test;
+
+/* Create a square in the xy plane at a height. */
+Geometry createSquare(float min, float max, float z)
+{
+	std::vector<DVertex> points(4);
+	points[0].position = Vec3(min, min, z);
+	points[1].position = Vec3(max, min, z);
+	points[2].position = Vec3(max, max, z);
+	points[3].position = Vec3(min, max, z);
+	Geometry geometry;
+	geometry.setPoints(points);
+	geometry.setIndices({0, 1, 2, 0, 2, 3});
+	return geometry;
+}
+
+const Volume::Node *getLeaf(const Volume::Node *node, Vec3 point)
+{
+	while (node->getNode(0)) {
+		Vec3 center = node->getCenter();
+		int index = 0;
+		if (point.x >= center.x)
+			index |= 1;
+		if (point.y >= center.y)
+			index |= 2;
+		if (point.z >= center.z)
+			index |= 4;
+		node = node->getNode(index);
+	}
+	return node;
+}
+
+BOOST_AUTO_TEST_SUITE(obstacles)
+
+BOOST_AUTO_TEST_CASE(test_voxelize)
+{
+	Obstacles obstacles;
+	obstacles.setGeometry(createSquare(0.01f, 0.99f, 0.55f), 0.1f);
+	BOOST_TEST(obstacles.getCellCount() == 100);
+}
+
+BOOST_AUTO_TEST_CASE(test_save_load)
+{
+	const char *filename = "test_obstacles.cells";
+	Obstacles obstacles1;
+	obstacles1.setGeometry(createSquare(-1.0f, 1.0f, 2.0f), 0.2f, 0.5f);
+	BOOST_TEST(obstacles1.save(filename));
+
+	Obstacles obstacles2;
+	BOOST_TEST(obstacles2.load(filename));
+	BOOST_TEST((obstacles1 == obstacles2));
+	BOOST_TEST(obstacles2.getDensity() == 0.5f);
+	std::remove(filename);
+	BOOST_TEST(!obstacles2.load(filename));
+}
+
+BOOST_AUTO_TEST_CASE(test_merge)
+{
+	Obstacles obstacles;
+	obstacles.setGeometry(createSquare(-0.9f, 0.9f, 1.3f), 0.125f);
+
+	Volume volume1(2.0f, 4);
+	volume1.addLine(Vec3(0.0f, 0.0f, 0.1f), Vec3(0.0f, 0.0f, 1.8f),
+		0.3f, 0.01f);
+	obstacles.merge(&volume1);
+	const Volume::Node *root = volume1.getRoot();
+	BOOST_TEST(getLeaf(root, Vec3(0.5f, 0.5f, 1.3f))->getDensity() == 1.0f);
+	BOOST_TEST(getLeaf(root, Vec3(0.5f, 0.5f, 0.5f))->getDensity() == 0.0f);
+	BOOST_TEST(getLeaf(root, Vec3(0.0f, 0.0f, 0.5f))->getDensity() == 0.3f);
+
+	/* The cells cover the whole cross section of the larger nodes. */
+	Volume volume2(2.0f, 2);
+	obstacles.merge(&volume2);
+	root = volume2.getRoot();
+	BOOST_TEST(getLeaf(root, Vec3(0.0f, 0.0f, 1.3f))->getDensity() == 1.0f);
+}
+
+BOOST_AUTO_TEST_CASE(test_remove_line)
+{
+	Obstacles obstacles;
+	obstacles.setGeometry(createSquare(-0.9f, 0.9f, 1.0f), 0.125f);
+
+	Volume volume(2.0f, 4);
+	std::vector<Volume::Node *> nodes;
+	volume.addLine(Vec3(0.0f, 0.0f, 0.1f), Vec3(0.0f, 0.0f, 1.8f),
+		0.3f, 0.01f, nodes);
+	obstacles.merge(&volume);
+	const Volume::Node *root = volume.getRoot();
+	const Volume::Node *leaf = getLeaf(root, Vec3(0.01f, 0.01f, 1.01f));
+	BOOST_TEST(leaf->getDensity() == 1.0f);
+	volume.removeLine(nodes);
+	BOOST_TEST(leaf->getDensity() == 1.0f);
+	leaf = getLeaf(root, Vec3(0.0f, 0.0f, 0.5f));
+	BOOST_TEST(leaf->getDensity() == 0.0f);
+}
+
+BOOST_AUTO_TEST_CASE(test_patches)
+{
+	Obstacles obstacles;
+	obstacles.setGeometry(createSquare(-0.9f, 0.9f, 1.3f), 0.125f);
+	Volume volume(2.0f, 2);
+	std::vector<Obstacles::Patch> patches;
+	obstacles.getPatches(&volume, patches);
+	BOOST_TEST(patches.size() == 16);
+	int cells = 0;
+	for (const Obstacles::Patch &patch : patches)
+		cells += patch.cells;
+	BOOST_TEST(cells == obstacles.getCellCount());
+}
+
+BOOST_AUTO_TEST_CASE(test_outside)
+{
+	Plant plant;
+	plant.setDefault();
+	Generator generator(&plant);
+	generator.cycles = 1;
+	generator.nodes = 1;
+	generator.rays = 100;
+	generator.grow();
+
+	Obstacles obstacles;
+	obstacles.setGeometry(createSquare(3.0f, 4.0f, 1.0f), 0.25f);
+	generator.obstacles = &obstacles;
+	generator.updateFlux();
+	const Volume::Node *root = generator.getVolume()->getRoot();
+	BOOST_TEST(root->getSize() > 4.0f);
+	Vec3 point(3.5f, 3.5f, 1.1f);
+	BOOST_TEST(getLeaf(root, point)->getDensity() > 0.0f);
+}
+
+BOOST_AUTO_TEST_CASE(test_shade)
+{
+	Plant plant;
+	plant.setDefault();
+	Generator generator(&plant);
+	generator.cycles = 2;
+	generator.nodes = 3;
+	generator.rays = 2000;
+	generator.grow();
+	/* The plant is wider after the last nodes are added. */
+	generator.updateFlux();
+
+	const Volume::Node *root = generator.getVolume()->getRoot();
+	float size = root->getSize();
+	Vec3 point(0.8f*size, 0.8f*size, 0.2f*size);
+	float light = magnitude(getLeaf(root, point)->getDirection());
+	BOOST_TEST(light > 0.0f);
+
+	/* The volume grows to contain the square, so the square is wide
+	enough that no ray can reach the point from the side. Cells that are
+	not aligned with the nodes let a little light through. */
+	Obstacles obstacles;
+	Geometry square = createSquare(-4.0f*size, 4.0f*size, size * 1.2f);
+	obstacles.setGeometry(square, size / 8.0f);
+	generator.obstacles = &obstacles;
+	generator.updateFlux();
+	root = generator.getVolume()->getRoot();
+	Vec3 direction = getLeaf(root, point)->getDirection();
+	BOOST_TEST(magnitude(direction) < 0.1f * light);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
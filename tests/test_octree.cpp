@@ -1,50 +1,191 @@
 #define BOOST_TEST_DYN_LINK
 #include <boost/test/unit_test.hpp>
 
+#include <boost/mpl/list.hpp>
+
 #include "../plant_generator/volume.h"
+#include "../plant_generator/linear_volume.h"
 
 using namespace pg;
 namespace bt = boost::unit_test;
+namespace tt = boost::test_tools;
+
+typedef boost::mpl::list<Volume, LinearVolume> Volumes;
 
 const float tolerance = 0.000001f;
 
+Vec3 getCenter(Volume &, Volume::Node *node)
+{
+	return node->getCenter();
+}
+
+Vec3 getCenter(LinearVolume &volume, LinearVolume::Node *node)
+{
+	return volume.getCenter(node);
+}
+
 BOOST_AUTO_TEST_SUITE(octree)
 
-BOOST_AUTO_TEST_CASE(test_get_node, *bt::tolerance(tolerance))
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_get_node, T, Volumes)
 {
-	Volume volume(1.0f, 3);
+	T volume(1.0f, 3);
 	Vec3 point(0.76f-0.5f, 0.126f-0.5f, 0.26f);
-	Volume::Node *node1 = volume.addNode(point);
-	Volume::Node *node2 = volume.getNode(point);
+	typename T::Node *node1 = volume.addNode(point);
+	typename T::Node *node2 = volume.getNode(point);
 	BOOST_TEST(node1 == node2);
-	Vec3 center = node1->getCenter();
-	BOOST_TEST(center.x == 0.8125f-0.5f);
-	BOOST_TEST(center.y == 0.1875f-0.5f);
-	BOOST_TEST(center.z == 0.3125f);
+	Vec3 center = getCenter(volume, node1);
+	BOOST_TEST(center.x == 0.8125f-0.5f, tt::tolerance(tolerance));
+	BOOST_TEST(center.y == 0.1875f-0.5f, tt::tolerance(tolerance));
+	BOOST_TEST(center.z == 0.3125f, tt::tolerance(tolerance));
 }
 
-BOOST_AUTO_TEST_CASE(test_add_line)
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_add_line, T, Volumes)
 {
-	/* This test will fail if the ray direction is diagonal to the volume
-	due to floating point precision errors. */
-	Volume volume(1.0f, 3);
+	T volume(1.0f, 3);
 	Vec3 a(-0.5f, -0.5f, 0.1f);
 	Vec3 b(0.99f-0.5f, 0.01f-0.5f, 0.01f);
 	Vec3 c(0.51f, 0.50f, 0.1f);
 	float weight = 0.6f;
 
 	volume.addLine(a, b, weight, 0.001f);
-	Volume::Node *node1 = volume.getNode(a);
-	Volume::Node *node2 = volume.getNode(b);
+	typename T::Node *node1 = volume.getNode(a);
+	typename T::Node *node2 = volume.getNode(b);
 	BOOST_TEST(node1->getDepth() == 3);
 	BOOST_TEST(node2->getDepth() == 3);
 	BOOST_TEST(node1->getDensity() == weight);
 	BOOST_TEST(node2->getDensity() == weight);
 
 	volume.addLine(a, c, weight, 0.001f);
-	Volume::Node *node3 = volume.getNode(c);
+	typename T::Node *node3 = volume.getNode(c);
 	BOOST_TEST(node3->getDepth() == 3);
 	BOOST_TEST(node3->getDensity() == weight);
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_add_diagonal_line, T, Volumes)
+{
+	T volume(1.0f, 3);
+	Vec3 a(-0.45f, -0.45f, 0.05f);
+	Vec3 b(0.45f, 0.45f, 0.95f);
+	volume.addLine(a, b, 1.0f, 0.001f);
+	for (int i = 0; i < 8; i++) {
+		float x = 0.125f*i - 0.4375f;
+		float z = 0.125f*i + 0.0625f;
+		typename T::Node *node = volume.getNode(Vec3(x, x, z));
+		BOOST_TEST(node->getDepth() == 3);
+		BOOST_TEST(node->getDensity() == 1.0f);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_traversal)
+{
+	Volume volume(1.0f, 3);
+	volume.addNode(Vec3(0.4f, 0.0f, 0.1f));
+	Ray ray(Vec3(-0.45f, 0.05f, 0.1f), normalize(Vec3(1.0f, 0.1f, 0.0f)));
+	Volume::Traversal traversal(volume.getNode(ray.origin), ray);
+	Volume::Node *node = traversal.getNode();
+	float x = -1.0f;
+	int count = 0;
+	while (node) {
+		BOOST_TEST(node->getCenter().x >= x);
+		x = node->getCenter().x;
+		node = traversal.next();
+		count++;
+	}
+	BOOST_TEST(x > 0.4f);
+	BOOST_TEST(count > 3);
+}
+
+BOOST_AUTO_TEST_CASE(test_remove_line)
+{
+	Volume volume(1.0f, 3);
+	Vec3 a(-0.4f, -0.4f, 0.1f);
+	Vec3 b(0.4f, -0.4f, 0.1f);
+	Vec3 c(-0.4f, 0.4f, 0.1f);
+	std::vector<Volume::Node *> line1;
+	std::vector<Volume::Node *> line2;
+	volume.addLine(a, b, 1.0f, 0.001f, line1);
+	volume.addLine(a, c, 1.0f, 0.001f, line2);
+	BOOST_TEST(line1.size() > 1);
+	BOOST_TEST(line2.size() > 1);
+
+	volume.removeLine(line1);
+	BOOST_TEST(volume.getNode(a)->getDensity() == 1.0f);
+	BOOST_TEST(volume.getNode(b)->getDensity() == 0.0f);
+	BOOST_TEST(volume.getNode(c)->getDensity() == 1.0f);
+	volume.removeLine(line2);
+	BOOST_TEST(volume.getNode(a)->getDensity() == 0.0f);
+	BOOST_TEST(volume.getNode(c)->getDensity() == 0.0f);
+}
+
+BOOST_AUTO_TEST_CASE(test_reuse_memory)
+{
+	Volume volume(1.0f, 4);
+	BOOST_TEST(volume.getNodeCount() == 1);
+	volume.addNode(Vec3(0.1f, 0.1f, 0.1f));
+	BOOST_TEST(volume.getNodeCount() == 33);
+	size_t bytes = volume.getByteCount();
+
+	volume.clear(2.0f, 4);
+	BOOST_TEST(volume.getNodeCount() == 1);
+	BOOST_TEST(volume.getRoot()->getNode(0) == nullptr);
+	Volume::Node *node = volume.addNode(Vec3(0.1f, 0.1f, 0.1f));
+	BOOST_TEST(volume.getNodeCount() == 33);
+	BOOST_TEST(volume.getByteCount() == bytes);
+	BOOST_TEST(node->getDepth() == 4);
+	BOOST_TEST(node->getDensity() == 0.0f);
+	BOOST_TEST(node->getQuantity() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_reduce)
+{
+	Volume volume(1.0f, 4);
+	volume.addNode(Vec3(0.1f, 0.1f, 0.1f));
+	volume.addNode(Vec3(-0.4f, 0.3f, 0.8f));
+	/* Count the nodes of each subtree. */
+	volume.reduce([] (Volume::Node *node) {
+		int quantity = 1;
+		for (int i = 0; node->getNode(0) && i < 8; i++)
+			quantity += node->getNode(i)->getQuantity();
+		node->setQuantity(quantity);
+	}, 3);
+	const Volume::Node *root = volume.getRoot();
+	BOOST_TEST(root->getQuantity() == volume.getNodeCount());
+	BOOST_TEST(root->getNode(0)->getQuantity() == 1);
+}
+
+BOOST_AUTO_TEST_CASE(test_adjacent_code)
+{
+	LinearVolume volume(1.0f, 3);
+	LinearVolume::Node *node = volume.addNode(Vec3(-0.3f, -0.3f, 0.2f));
+	uint64_t code = node->getCode();
+	Ray ray(volume.getCenter(node), Vec3(1.0f, 0.0f, 0.0f));
+	for (int i = 0; i < 6; i++) {
+		Vec3 point = ray.origin + Vec3(0.125f*(i+1), 0.0f, 0.0f);
+		volume.addNode(point);
+		node = volume.getNode(code);
+		LinearVolume::Node *next = volume.getAdjacentNode(node, ray);
+		BOOST_TEST(next != node);
+		BOOST_TEST(next->getDepth() == 3);
+		Vec3 center = volume.getCenter(next);
+		BOOST_TEST(center.x == point.x, tt::tolerance(tolerance));
+		BOOST_TEST(center.y == point.y, tt::tolerance(tolerance));
+		code = next->getCode();
+	}
+	node = volume.getNode(code);
+	BOOST_TEST(volume.getAdjacentNode(node, ray) == node);
+	BOOST_TEST(volume.getParent(node)->getDepth() == 2);
+}
+
+BOOST_AUTO_TEST_CASE(test_code)
+{
+	LinearVolume volume(1.0f, 3);
+	LinearVolume::Node *node = volume.addNode(Vec3(0.3f, -0.3f, 0.8f));
+	uint64_t code = node->getCode();
+	BOOST_TEST(volume.getNode(code) == node);
+	BOOST_TEST(volume.getNode(code >> 3) == volume.getParent(node));
+	/* The sibling of the parent was never divided. */
+	BOOST_TEST(!volume.getNode(((code >> 3) ^ 1) << 3));
+	BOOST_TEST(!volume.getNode(code << 3));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -2,6 +2,9 @@
 #include <boost/test/unit_test.hpp>
 
 #include "../plant_generator/path.h"
+#include "../plant_generator/plant.h"
+#include <algorithm>
+#include <limits>
 
 using namespace pg;
 namespace bt = boost::unit_test;
@@ -31,4 +34,143 @@ BOOST_AUTO_TEST_CASE(test_get_index)
 	BOOST_TEST(path.toPathIndex(3) == 1);
 }
 
+BOOST_AUTO_TEST_CASE(test_add_control)
+{
+	Spline spline;
+	spline.setDegree(1);
+	spline.addControl(Vec3(0.0f, 0.0f, 0.0f));
+	spline.addControl(Vec3(0.0f, 1.0f, 0.0f));
+	Path path;
+	path.setDivisions(2);
+	path.setInitialDivisions(1);
+	path.setSpline(spline);
+	path.generate();
+
+	Path generatedPath = path;
+	for (int i = 0; i < 3; i++) {
+		Vec3 control(0.5f*i, 2.0f+i, 0.0f);
+		path.addControl(control);
+		spline.addControl(control);
+		generatedPath.setSpline(spline);
+		generatedPath.generate();
+		BOOST_TEST((path == generatedPath));
+		BOOST_TEST(path.getLength() == generatedPath.getLength());
+	}
+}
+
+/* A control that does not complete a cubic curve replaces the last point
+of the path, so children before the old end of the path move. */
+BOOST_AUTO_TEST_CASE(test_extend_cubic)
+{
+	Plant plant;
+	Stem *root = plant.createRoot();
+	Path path;
+	path.setDivisions(2);
+	path.setSpline(createCubicSpline());
+	root->setPath(path);
+	Stem *child = plant.addStem(root);
+	float distance = 0.9f * root->getPath().getLength();
+	child->setDistance(distance);
+	child->getLocation();
+
+	Path before = root->getPath();
+	root->extendPath(Vec3(1.0f, 2.0f, 0.0f));
+	Vec3 location = root->getPath().getIntermediate(distance);
+	BOOST_TEST(root->getPath().getLength() > before.getLength());
+	BOOST_TEST(child->getLocation() == root->getLocation() + location);
+	BOOST_TEST(location != before.getIntermediate(distance));
+}
+
+BOOST_AUTO_TEST_CASE(test_distances)
+{
+	Spline spline;
+	spline.setDegree(1);
+	for (int i = 0; i < 20; i++)
+		spline.addControl(Vec3(0.1f*i*i, 0.5f*i, 0.0f));
+	Path path;
+	path.setDivisions(2);
+	path.setSpline(spline);
+	path.generate();
+
+	float distance = 0.0f;
+	for (size_t i = 0; i < path.getSize(); i++) {
+		if (i > 0)
+			distance += magnitude(path.get(i) - path.get(i-1));
+		BOOST_TEST(path.getDistance(i) == distance);
+		BOOST_TEST(path.getPercentage(i) == distance/path.getLength());
+	}
+	for (size_t i = 0; i + 1 < path.getSize(); i++) {
+		float d = 0.5f * (path.getDistance(i) + path.getDistance(i+1));
+		BOOST_TEST(path.getIndex(d) == i);
+		Vec3 direction = path.getDirection(i);
+		BOOST_TEST(path.getIntermediateDirection(d) == direction);
+		Vec3 point = path.get(i) + (d - path.getDistance(i))*direction;
+		BOOST_TEST(path.getIntermediate(d) == point);
+	}
+	BOOST_TEST(path.getIndex(distance + 1.0f) == path.getSize());
+	BOOST_TEST(path.getIntermediate(distance + 1.0f) == path.get(
+		path.getSize()-1));
+}
+
+float getSegmentDistance(Vec3 point, Vec3 a, Vec3 b)
+{
+	Vec3 line = b - a;
+	float t = dot(point - a, line) / dot(line, line);
+	t = std::min(std::max(t, 0.0f), 1.0f);
+	return magnitude(point - (a + t*line));
+}
+
+BOOST_AUTO_TEST_CASE(test_subdivide)
+{
+	const float tolerance = 0.01f;
+	Spline spline;
+	spline.setDegree(3);
+	spline.addControl(Vec3(0.0f, 0.0f, 0.0f));
+	spline.addControl(Vec3(0.0f, 0.0f, 1.0f));
+	spline.addControl(Vec3(0.0f, 0.0f, 2.0f));
+	spline.addControl(Vec3(0.0f, 0.0f, 3.0f));
+	/* A straight curve is followed by a bent curve. */
+	for (int i = 1; i <= 3; i++)
+		spline.addControl(Vec3(0.0f, 0.0f, 3.0f + i));
+	spline.addControl(Vec3(1.0f, 0.0f, 7.0f));
+	spline.addControl(Vec3(2.0f, 0.0f, 6.0f));
+	spline.addControl(Vec3(2.0f, 0.0f, 5.0f));
+	Path path;
+	path.setInitialDivisions(3);
+	path.setDivisions(20);
+	path.setSpline(spline);
+	path.subdivide(tolerance);
+	path.generate();
+
+	BOOST_TEST(path.getCurveDivisions(0) == 3);
+	BOOST_TEST(path.getCurveDivisions(1) == 0);
+	BOOST_TEST(path.getCurveDivisions(2) > 0);
+	BOOST_TEST(path.getCurveDivisions(2) < 20);
+	size_t size = 4 + 1 + (path.getCurveDivisions(2) + 1) + 1;
+	BOOST_TEST(path.getSize() == size);
+
+	const std::vector<Vec3> &controls = spline.getControls();
+	for (int curve = 0; curve <= spline.getCurveCount(); curve++) {
+		Vec3 point = path.get(path.toPathIndex(3*curve));
+		BOOST_TEST(magnitude(point - controls[3*curve]) < 1e-5f);
+	}
+
+	/* Points on the curves are close to the path. */
+	for (int curve = 0; curve < spline.getCurveCount(); curve++) {
+		size_t start = path.toPathIndex(3*curve);
+		size_t end = path.toPathIndex(3*curve + 3);
+		for (int i = 0; i <= 100; i++) {
+			Vec3 point = spline.getPoint(curve, 0.01f*i);
+			float distance = std::numeric_limits<float>::max();
+			for (size_t j = start; j < end; j++) {
+				Vec3 a = path.get(j);
+				Vec3 b = path.get(j+1);
+				float d = getSegmentDistance(point, a, b);
+				distance = std::min(distance, d);
+			}
+			BOOST_TEST(distance <= tolerance);
+		}
+	}
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -40,6 +40,28 @@ BOOST_AUTO_TEST_CASE(test_allocate)
 	BOOST_TEST(pool.getPoolID(stem) == 1);
 }
 
+BOOST_AUTO_TEST_CASE(test_shrink)
+{
+	StemPool pool;
+	const int poolCount = 3;
+	std::vector<Stem *> stems[poolCount];
+	for (int j = 0; j < poolCount; j++)
+		for (size_t i = 0; i < PG_POOL_SIZE; i++)
+			stems[j].push_back(pool.allocate());
+	BOOST_TEST(pool.getStemCount() == poolCount * PG_POOL_SIZE);
+
+	pool.deallocate(stems[1]);
+	pool.deallocate(stems[2].back());
+	BOOST_TEST(pool.getStemCount() == PG_POOL_SIZE * 2 - 1);
+	BOOST_TEST(pool.shrink() == 1);
+	BOOST_TEST(pool.getPoolCount() == 2);
+	BOOST_TEST(pool.getRemaining(2) == 0);
+
+	/* Stems of the released pool should not be reused. */
+	BOOST_TEST(pool.allocate() == stems[2].back());
+	BOOST_TEST(pool.getPoolID(pool.allocate()) == poolCount + 1);
+}
+
 BOOST_AUTO_TEST_CASE(test_same_address)
 {
 	StemPool pool;
@@ -54,6 +76,34 @@ BOOST_AUTO_TEST_CASE(test_same_address)
 	BOOST_TEST(stem1 == pool.allocate());
 }
 
+BOOST_AUTO_TEST_CASE(test_allocate_removed)
+{
+	StemPool pool;
+	Stem *stem1 = pool.allocate();
+	Stem *stem2 = pool.allocate();
+	pool.deallocate(stem1);
+	pool.deallocate(stem2);
+	BOOST_TEST(pool.allocate(stem1) == stem1);
+	BOOST_TEST(pool.getStemCount() == 1);
+
+	/* The stem is not available once it is allocated again. */
+	BOOST_TEST(pool.allocate() == stem2);
+	pool.deallocate(stem1);
+	BOOST_TEST(pool.allocate() == stem1);
+	Stem *stem3 = pool.allocate(stem1);
+	BOOST_TEST(stem3 != stem1);
+	BOOST_TEST(stem3 != stem2);
+	BOOST_TEST(pool.getStemCount() == 3);
+
+	/* The pool of the stem was released. */
+	pool.deallocate({stem1, stem2, stem3});
+	BOOST_TEST(pool.shrink() == 1);
+	Stem *stem4 = pool.allocate(stem1);
+	BOOST_TEST(pool.getPoolCount() == 1);
+	BOOST_TEST(pool.getPoolID(stem4) == 2);
+	BOOST_TEST(pool.getStemCount() == 1);
+}
+
 BOOST_AUTO_TEST_CASE(test_last_stem_is_first)
 {
 	Plant plant;
@@ -162,4 +212,38 @@ BOOST_AUTO_TEST_CASE(test_extract)
 	BOOST_TEST(stem1->getSibling() == nullptr);
 }
 
+void setLinePath(Stem *stem, Vec3 end)
+{
+	Spline spline;
+	spline.setDegree(1);
+	spline.addControl(Vec3(0.0f, 0.0f, 0.0f));
+	spline.addControl(end);
+	Path path;
+	path.setSpline(spline);
+	stem->setPath(path);
+}
+
+/* Locations follow the paths of the ancestors when they are requested. */
+BOOST_AUTO_TEST_CASE(test_locations)
+{
+	Plant plant;
+	Stem *root = plant.createRoot();
+	setLinePath(root, Vec3(0.0f, 0.0f, 10.0f));
+	Stem *child = plant.addStem(root);
+	setLinePath(child, Vec3(4.0f, 0.0f, 0.0f));
+	child->setDistance(5.0f);
+	Stem *grandchild = plant.addStem(child);
+	grandchild->setDistance(2.0f);
+	BOOST_TEST((grandchild->getLocation() == Vec3(2.0f, 0.0f, 5.0f)));
+
+	setLinePath(root, Vec3(10.0f, 0.0f, 0.0f));
+	plant.updateLocations();
+	BOOST_TEST((child->getLocation() == Vec3(5.0f, 0.0f, 0.0f)));
+	BOOST_TEST((grandchild->getLocation() == Vec3(7.0f, 0.0f, 0.0f)));
+
+	setLinePath(child, Vec3(0.0f, 4.0f, 0.0f));
+	BOOST_TEST((grandchild->getLocation() == Vec3(5.0f, 2.0f, 0.0f)));
+	BOOST_TEST((child->getLocation() == Vec3(5.0f, 0.0f, 0.0f)));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,60 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include "../plant_generator/shadow_grid.h"
+
+using namespace pg;
+namespace bt = boost::unit_test;
+
+BOOST_AUTO_TEST_SUITE(shadow_grid)
+
+/* A single occupied cell in the top slab of a grid with eight cells along
+each axis. */
+void createGrid(ShadowGrid &grid, int threads)
+{
+	Volume volume(2.0f, 3);
+	volume.addNode(Vec3(0.125f, 0.125f, 1.875f), 3)->setDensity(1.0f);
+	grid.setVolume(&volume, 3);
+	grid.propagate(threads);
+}
+
+BOOST_AUTO_TEST_CASE(test_occluder, *bt::tolerance(0.00001f))
+{
+	ShadowGrid grid;
+	createGrid(grid, 1);
+	BOOST_TEST(grid.getResolution() == 8);
+
+	/* The cells below the occluder are shaded and the shadow spreads
+	by one cell in each slab. */
+	for (int z = 0; z < 7; z++) {
+		BOOST_TEST(grid.getShadow(4, 4, z) > 0.0f);
+		BOOST_TEST(grid.getShadow(4, 4, z) < 1.0f);
+		BOOST_TEST(grid.getShadow(4 - (7-z), 4, z) > 0.0f);
+		if (7-z < 4)
+			BOOST_TEST(grid.getShadow(0, 0, z) == 0.0f);
+	}
+	BOOST_TEST(grid.getShadow(4, 4, 7) == 0.0f);
+
+	Vec3 below = grid.getFlux(Vec3(0.125f, 0.125f, 1.625f));
+	BOOST_TEST(magnitude(below) < 0.9f);
+	Vec3 open = grid.getFlux(Vec3(-0.875f, -0.875f, 1.625f));
+	BOOST_TEST(magnitude(open) == 1.0f);
+	BOOST_TEST(open.z == -1.0f);
+}
+
+BOOST_AUTO_TEST_CASE(test_threads)
+{
+	ShadowGrid grid1;
+	createGrid(grid1, 1);
+	ShadowGrid grid2;
+	createGrid(grid2, 3);
+	for (int z = 0; z < 8; z++)
+		for (int y = 0; y < 8; y++)
+			for (int x = 0; x < 8; x++) {
+				float s1 = grid1.getShadow(x, y, z);
+				float s2 = grid2.getShadow(x, y, z);
+				BOOST_TEST(s1 == s2);
+			}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,39 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include "../plant_generator/sky.h"
+
+using namespace pg;
+namespace bt = boost::unit_test;
+namespace tt = boost::test_tools;
+
+BOOST_AUTO_TEST_SUITE(sky)
+
+BOOST_AUTO_TEST_CASE(test_weights)
+{
+	Sky sky(4);
+	BOOST_TEST(sky.getBinCount() == 64);
+	float total = 0.0f;
+	for (int i = 0; i < sky.getBinCount(); i++)
+		total += sky.getWeight(i);
+	BOOST_TEST(total == 1.0f, tt::tolerance(0.0001f));
+}
+
+BOOST_AUTO_TEST_CASE(test_sample_bins)
+{
+	Sky sky(4);
+	for (int i = 0; i < 100; i++) {
+		float u = i / 100.0f;
+		int bin = sky.getBin(u);
+		BOOST_TEST(bin >= 0);
+		BOOST_TEST(bin < sky.getBinCount());
+		BOOST_TEST(u >= 0.0f);
+		BOOST_TEST(u < 1.0f);
+		Vec3 direction = sky.getDirection(bin, u, 0.5f);
+		float length = magnitude(direction);
+		BOOST_TEST(length == 1.0f, tt::tolerance(0.0001f));
+		BOOST_TEST(direction.z <= 0.0f);
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,6 +1,7 @@
 #define BOOST_TEST_DYN_LINK
 #include <boost/test/unit_test.hpp>
 
+#include "../plant_generator/curve.h"
 #include "../plant_generator/spline.h"
 
 using namespace pg;
@@ -101,4 +102,26 @@ BOOST_AUTO_TEST_CASE(test_parallelize_linear)
 	BOOST_TEST(controls[1] == spline.getControls()[1]);
 }
 
+BOOST_AUTO_TEST_CASE(test_curve_table)
+{
+	Spline spline(0);
+	Curve curve(spline);
+	std::vector<float> t;
+	for (int i = 0; i <= 1000; i++)
+		t.push_back(i / 1000.0f);
+	std::vector<float> values(t.size());
+	curve.getValues(t.data(), values.data(), t.size());
+	for (size_t i = 0; i < t.size(); i++) {
+		float y = spline.getPoint(t[i]).y;
+		BOOST_TEST(std::abs(values[i] - y) < 0.001f);
+		BOOST_TEST(curve.getValue(t[i]) == values[i]);
+	}
+	BOOST_TEST(curve.getValue(-1.0f) == spline.getPoint(-1.0f).y);
+	BOOST_TEST(curve.getValue(2.0f) == spline.getPoint(2.0f).y);
+
+	spline.setDefault(2);
+	curve.setSpline(spline);
+	BOOST_TEST(std::abs(curve.getValue(0.5f) - 0.75f) < tolerance);
+}
+
 BOOST_AUTO_TEST_SUITE_END()